@@ -34,6 +34,18 @@
 #include "brawcap_handle.hpp"
 #include "brawcap_receive.hpp"
 #include "brawcap_transmit.hpp"
+#include "brawcap_multi_receive.hpp"
+#include "brawcap_fanout.hpp"
+#include "brawcap_pcap_writer.hpp"
+#include "brawcap_pcapng_writer.hpp"
+#include "brawcap_dump.hpp"
+#include "brawcap_file_reader.hpp"
+#include "brawcap_snapshot.hpp"
+#include "brawcap_index_reader.hpp"
+#include "brawcap_compressed_reader.hpp"
+#include "brawcap_replay.hpp"
+#include "brawcap_paced_sender.hpp"
+#include "brawcap_frame_template.hpp"
 #endif // INCLUDES
 
 class BRAWcap : public BRAWcapReceive, public BRAWcapTransmit, virtual public BRAWcapHandle
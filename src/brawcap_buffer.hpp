@@ -27,22 +27,37 @@
 // STD
 // C
 #include <cstdbool>
+#include <cstddef>
 // CPP
 #include <memory>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
 
 // bRAWcap
 #include "libbrawcap.h"
 #include "brawcap_packet.hpp"
+#include "brawcap_packet_view.hpp"
 #endif // INCLUDES
 
 class BRAWcapBuffer
 {
   friend class BRAWcapReceive;
   friend class BRAWcapTransmit;
+  friend class BRAWcapReplay;
 public:
+  // Copies share the native iterator and advance together, so this is single pass only. PacketIterator is the
+  // random access alternative.
   class Iterator
   {
     public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = BRAWcapPacket;
+      using difference_type = std::ptrdiff_t;
+      using pointer = BRAWcapPacket*;
+      using reference = BRAWcapPacket&;
+      
       inline Iterator(std::shared_ptr<brawcap_buffer_t> buffer, brawcap_buffer_packet_count_t startIndex = 0)
         : m_packet(buffer, nullptr)
       {
@@ -97,12 +112,12 @@ public:
         return &m_packet;
       }
       
-      inline bool operator== (const Iterator& b)
+      inline bool operator== (const Iterator& b) const
       {
         return m_packet.m_pBufferedPacket == b.m_packet.m_pBufferedPacket;
       }
       
-      inline bool operator!= (const Iterator& b)
+      inline bool operator!= (const Iterator& b) const
       {
         return m_packet.m_pBufferedPacket != b.m_packet.m_pBufferedPacket;
       }
@@ -113,6 +128,131 @@ public:
       BRAWcapPacket m_packet;
   };
   
+  class PacketIterator
+  {
+    public:
+      using iterator_category = std::random_access_iterator_tag;
+      using iterator_concept = std::random_access_iterator_tag;
+      using value_type = BRAWcapPacketView;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = BRAWcapPacketView;
+      
+      inline PacketIterator()
+        : m_pBuffer(nullptr), m_index(0)
+      { }
+      
+      inline PacketIterator(brawcap_buffer_t* const pBuffer, const difference_type index)
+        : m_pBuffer(pBuffer), m_index(index)
+      { }
+      
+      inline BRAWcapPacketView operator*() const
+      {
+        brawcap_packet_t* pPacket = nullptr;
+        brawcap_status_t status = brawcap_buffer_at_index(m_pBuffer, static_cast<brawcap_buffer_packet_count_t>(m_index),
+          &pPacket);
+        assert(BRAWCAP_SUCCESS(status) && pPacket);
+        return BRAWcapPacketView(pPacket);
+      }
+      
+      inline BRAWcapPacketView operator[](const difference_type offset) const
+      {
+        return *(*this + offset);
+      }
+      
+      inline PacketIterator& operator++()
+      {
+        ++m_index;
+        return *this;
+      }
+      
+      inline PacketIterator operator++(int)
+      {
+        PacketIterator result(*this);
+        ++m_index;
+        return result;
+      }
+      
+      inline PacketIterator& operator--()
+      {
+        --m_index;
+        return *this;
+      }
+      
+      inline PacketIterator operator--(int)
+      {
+        PacketIterator result(*this);
+        --m_index;
+        return result;
+      }
+      
+      inline PacketIterator& operator+=(const difference_type offset)
+      {
+        m_index += offset;
+        return *this;
+      }
+      
+      inline PacketIterator& operator-=(const difference_type offset)
+      {
+        m_index -= offset;
+        return *this;
+      }
+      
+      inline PacketIterator operator+(const difference_type offset) const
+      {
+        return PacketIterator(m_pBuffer, m_index + offset);
+      }
+      
+      inline friend PacketIterator operator+(const difference_type offset, const PacketIterator& it)
+      {
+        return it + offset;
+      }
+      
+      inline PacketIterator operator-(const difference_type offset) const
+      {
+        return PacketIterator(m_pBuffer, m_index - offset);
+      }
+      
+      inline difference_type operator-(const PacketIterator& b) const
+      {
+        return m_index - b.m_index;
+      }
+      
+      inline bool operator== (const PacketIterator& b) const
+      {
+        return m_index == b.m_index;
+      }
+      
+      inline bool operator!= (const PacketIterator& b) const
+      {
+        return m_index != b.m_index;
+      }
+      
+      inline bool operator< (const PacketIterator& b) const
+      {
+        return m_index < b.m_index;
+      }
+      
+      inline bool operator> (const PacketIterator& b) const
+      {
+        return m_index > b.m_index;
+      }
+      
+      inline bool operator<= (const PacketIterator& b) const
+      {
+        return m_index <= b.m_index;
+      }
+      
+      inline bool operator>= (const PacketIterator& b) const
+      {
+        return m_index >= b.m_index;
+      }
+    
+    private:
+      brawcap_buffer_t* m_pBuffer;
+      difference_type m_index;
+  };
+  
 public:
   inline BRAWcapBuffer(const brawcap_packet_size_t packetMaxPayloadSize, const brawcap_buffer_packet_count_t numPackets)
   {
@@ -180,7 +320,7 @@ public:
   
   inline BRAWcapPacket Back()
   {
-    return At(Count());
+    return At(Count() - 1);
   }
   
   inline BRAWcapPacket At(const brawcap_buffer_packet_count_t index)
@@ -192,6 +332,25 @@ public:
     return BRAWcapPacket(m_pBuffer, pPacket);
   }
   
+  inline BRAWcapPacketView ViewFront()
+  {
+    return ViewAt(0);
+  }
+  
+  inline BRAWcapPacketView ViewBack()
+  {
+    return ViewAt(Count() - 1);
+  }
+  
+  inline BRAWcapPacketView ViewAt(const brawcap_buffer_packet_count_t index)
+  {
+    brawcap_packet_t* pPacket = nullptr;
+    if(!BRAWCAP_SUCCESS(brawcap_buffer_at_index(m_pBuffer.get(), index, &pPacket)))
+      assert(false);
+    
+    return pPacket ? BRAWcapPacketView(pPacket) : BRAWcapPacketView();
+  }
+  
   inline brawcap_buffer_packet_count_t Count()
   {
     brawcap_buffer_packet_count_t count = 0;
@@ -226,8 +385,76 @@ public:
     return ++Iterator(m_pBuffer, count);
   }
   
+  inline PacketIterator begin() const
+  {
+    return PacketIterator(m_pBuffer.get(), 0);
+  }
+  
+  inline PacketIterator end() const
+  {
+    brawcap_buffer_packet_count_t count = 0;
+    if(!BRAWCAP_SUCCESS(brawcap_buffer_count(m_pBuffer.get(), &count)))
+      assert(false);
+    return PacketIterator(m_pBuffer.get(), static_cast<PacketIterator::difference_type>(count));
+  }
+  
+  inline size_t size() const
+  {
+    brawcap_buffer_packet_count_t count = 0;
+    if(!BRAWCAP_SUCCESS(brawcap_buffer_count(m_pBuffer.get(), &count)))
+      assert(false);
+    return count;
+  }
+  
+  template<typename Visitor>
+  inline brawcap_buffer_packet_count_t ForEach(Visitor&& visitor)
+  {
+    return ForEachN(std::forward<Visitor>(visitor), 0, std::numeric_limits<brawcap_buffer_packet_count_t>::max());
+  }
+  
+  template<typename Visitor>
+  inline brawcap_buffer_packet_count_t ForEachN(Visitor&& visitor, const brawcap_buffer_packet_count_t first,
+    const brawcap_buffer_packet_count_t count)
+  {
+    if(!count)
+      return 0;
+    
+    brawcap_buffer_iterator_t* pIterator = nullptr;
+    brawcap_status_t status = brawcap_buffer_iterator_create(&pIterator, m_pBuffer.get(), first);
+    assert(!BRAWCAP_ERROR(status));
+    if(!pIterator)
+      return 0;
+    
+    brawcap_buffer_packet_count_t visited = 0;
+    brawcap_packet_t* pPacket = brawcap_buffer_iterator_eval(pIterator);
+    while(pPacket && visited < count)
+    {
+      ++visited;
+      // Visitors returning bool can stop the walk early by returning false.
+      if constexpr(std::is_same<decltype(visitor(std::declval<const BRAWcapPacketView&>())), bool>::value)
+      {
+        if(!visitor(BRAWcapPacketView(pPacket)))
+          break;
+      }
+      else
+        visitor(BRAWcapPacketView(pPacket));
+      
+      if(!BRAWCAP_SUCCESS(brawcap_buffer_iterator_next(pIterator)))
+        break;
+      pPacket = brawcap_buffer_iterator_eval(pIterator);
+    }
+    
+    brawcap_buffer_iterator_free(pIterator);
+    return visited;
+  }
+  
 private:
   std::shared_ptr<brawcap_buffer_t> m_pBuffer;
 };
 
+#if defined(__cpp_lib_concepts)
+static_assert(std::random_access_iterator<BRAWcapBuffer::PacketIterator>,
+  "BRAWcapBuffer::PacketIterator must model std::random_access_iterator.");
+#endif
+
 #endif // BRAWCAP_BUFFER_HPP
@@ -0,0 +1,154 @@
+/**
+ * @file brawcap_buffer_pool.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Buffer Pool.
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_BUFFER_POOL_HPP
+#define BRAWCAP_BUFFER_POOL_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cassert>
+// CPP
+#include <vector>
+#include <memory>
+#include <atomic>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_buffer.hpp"
+#include "brawcap_ring.hpp"
+#endif // INCLUDES
+
+class BRAWcapBufferPool
+{
+public:
+  inline BRAWcapBufferPool(const brawcap_packet_size_t maxPacketPayloadSize,
+    const brawcap_buffer_packet_count_t numPackets, const size_t numBuffers)
+    : m_maxPacketPayloadSize(maxPacketPayloadSize), m_numPackets(numPackets), m_freeBuffers(numBuffers),
+      m_inUse(0), m_inUseMax(0), m_acquireFailures(0)
+  {
+    assert(numBuffers);
+    m_buffers.reserve(numBuffers);
+    for(size_t index = 0; index < numBuffers; ++index)
+    {
+      m_buffers.push_back(std::make_unique<BRAWcapBuffer>(maxPacketPayloadSize, numPackets));
+      m_freeBuffers.TryPush(m_buffers.back().get());
+    }
+  }
+  
+  inline ~BRAWcapBufferPool()
+  {
+    assert(Available() == Size());
+  }
+  
+  BRAWcapBufferPool(const BRAWcapBufferPool&) = delete;
+  BRAWcapBufferPool& operator=(const BRAWcapBufferPool&) = delete;
+  
+  inline BRAWcapBuffer* Acquire()
+  {
+    BRAWcapBuffer* pBuffer = nullptr;
+    if(!m_freeBuffers.TryPop(pBuffer))
+    {
+      m_acquireFailures.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    
+    const size_t inUse = m_inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+    size_t inUseMax = m_inUseMax.load(std::memory_order_relaxed);
+    while(inUse > inUseMax && !m_inUseMax.compare_exchange_weak(inUseMax, inUse, std::memory_order_relaxed))
+    { }
+    return pBuffer;
+  }
+  
+  inline void Release(BRAWcapBuffer* pBuffer)
+  {
+    assert(pBuffer && Owns(pBuffer));
+    pBuffer->Clear();
+    m_inUse.fetch_sub(1, std::memory_order_relaxed);
+    const bool pushed = m_freeBuffers.TryPush(pBuffer);
+    assert(pushed);
+  }
+  
+  inline bool Owns(const BRAWcapBuffer* pBuffer) const
+  {
+    for(const auto& buffer : m_buffers)
+    {
+      if(buffer.get() == pBuffer)
+        return true;
+    }
+    return false;
+  }
+  
+  // Pool buffer by index, independent of whether it is in use.
+  inline BRAWcapBuffer* At(const size_t index) const
+  {
+    assert(index < m_buffers.size());
+    return m_buffers[index].get();
+  }
+  
+  inline size_t Size() const
+  {
+    return m_buffers.size();
+  }
+  
+  inline size_t Available() const
+  {
+    return m_freeBuffers.Size();
+  }
+  
+  inline size_t InUse() const
+  {
+    return m_inUse.load(std::memory_order_relaxed);
+  }
+  
+  inline size_t InUseMax() const
+  {
+    return m_inUseMax.load(std::memory_order_relaxed);
+  }
+  
+  inline uint64_t AcquireFailures() const
+  {
+    return m_acquireFailures.load(std::memory_order_relaxed);
+  }
+  
+  inline brawcap_packet_size_t MaxPacketPayloadSize() const
+  {
+    return m_maxPacketPayloadSize;
+  }
+  
+  inline brawcap_buffer_packet_count_t PacketsPerBuffer() const
+  {
+    return m_numPackets;
+  }
+  
+private:
+  const brawcap_packet_size_t m_maxPacketPayloadSize;
+  const brawcap_buffer_packet_count_t m_numPackets;
+  std::vector<std::unique_ptr<BRAWcapBuffer>> m_buffers;
+  BRAWcapRing<BRAWcapBuffer*> m_freeBuffers;
+  std::atomic<size_t> m_inUse;
+  std::atomic<size_t> m_inUseMax;
+  std::atomic<uint64_t> m_acquireFailures;
+};
+
+#endif // BRAWCAP_BUFFER_POOL_HPP
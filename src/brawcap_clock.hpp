@@ -0,0 +1,109 @@
+/**
+ * @file brawcap_clock.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Clock (pluggable time source for pacing).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_CLOCK_HPP
+#define BRAWCAP_CLOCK_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+// CPP
+#include <atomic>
+#include <thread>
+#include <chrono>
+#endif // INCLUDES
+
+// Time source used for pacing. Times are nanoseconds on an arbitrary but monotonic base.
+class BRAWcapClock
+{
+public:
+  inline virtual ~BRAWcapClock()
+  { }
+  
+  virtual uint64_t NowNs() = 0;
+  
+  // Returns once NowNs() has reached deadlineNs.
+  virtual void SleepUntilNs(const uint64_t deadlineNs) = 0;
+};
+
+// Host steady clock. Sleeps coarse until spinNs before the deadline and spins the rest, the scheduler granularity
+// on the capture host is far too coarse for inter packet gaps.
+class BRAWcapSteadyClock : public BRAWcapClock
+{
+public:
+  static constexpr uint64_t SPIN_NS_DEFAULT = 2000000;
+  
+public:
+  inline BRAWcapSteadyClock(const uint64_t spinNs = SPIN_NS_DEFAULT)
+    : m_spinNs(spinNs)
+  { }
+  
+  inline uint64_t NowNs() override
+  {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+  
+  inline void SleepUntilNs(const uint64_t deadlineNs) override
+  {
+    uint64_t now = NowNs();
+    if(now + m_spinNs < deadlineNs)
+      std::this_thread::sleep_for(std::chrono::nanoseconds(deadlineNs - now - m_spinNs));
+    while(NowNs() < deadlineNs)
+      std::this_thread::yield();
+  }
+  
+private:
+  uint64_t m_spinNs;
+};
+
+// Simulated clock, time only moves when somebody sleeps or advances it. Makes pacing deterministic and instant.
+class BRAWcapVirtualClock : public BRAWcapClock
+{
+public:
+  inline BRAWcapVirtualClock(const uint64_t startNs = 0)
+    : m_nowNs(startNs)
+  { }
+  
+  inline uint64_t NowNs() override
+  {
+    return m_nowNs.load(std::memory_order_acquire);
+  }
+  
+  inline void SleepUntilNs(const uint64_t deadlineNs) override
+  {
+    uint64_t now = m_nowNs.load(std::memory_order_relaxed);
+    while(now < deadlineNs && !m_nowNs.compare_exchange_weak(now, deadlineNs, std::memory_order_acq_rel))
+    { }
+  }
+  
+  inline void Advance(const uint64_t ns)
+  {
+    m_nowNs.fetch_add(ns, std::memory_order_acq_rel);
+  }
+  
+private:
+  std::atomic<uint64_t> m_nowNs;
+};
+
+#endif // BRAWCAP_CLOCK_HPP
@@ -0,0 +1,270 @@
+/**
+ * @file brawcap_compressed_reader.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Compressed Reader (random access to block compressed captures).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_COMPRESSED_READER_HPP
+#define BRAWCAP_COMPRESSED_READER_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_file_packet.hpp"
+#include "brawcap_pcap_writer.hpp"
+#include "brawcap_compressed_writer.hpp"
+#include "brawcap_lz.hpp"
+#endif // INCLUDES
+
+class BRAWcapCompressedReader
+{
+public:
+  typedef BRAWcapCompressedWriter::IndexEntry IndexEntry;
+  
+public:
+  inline BRAWcapCompressedReader()
+    : m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_pData(nullptr), m_size(0), m_pIndex(nullptr),
+      m_blockCount(0)
+  { }
+  
+  inline ~BRAWcapCompressedReader()
+  {
+    if(IsOpen())
+      Close();
+  }
+  
+  BRAWcapCompressedReader(const BRAWcapCompressedReader&) = delete;
+  BRAWcapCompressedReader& operator=(const BRAWcapCompressedReader&) = delete;
+  
+  inline bool Open(const std::string& path)
+  {
+    assert(!IsOpen());
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(m_file == INVALID_HANDLE_VALUE)
+      return false;
+    
+    LARGE_INTEGER size;
+    if(GetFileSizeEx(m_file, &size))
+      m_size = static_cast<uint64_t>(size.QuadPart);
+    if(m_size >= sizeof(BRAWcapCompressedWriter::FileHeader) + sizeof(BRAWcapCompressedWriter::Trailer))
+      m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(m_mapping)
+      m_pData = reinterpret_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if(!m_pData || !HeaderParse())
+    {
+      Close();
+      return false;
+    }
+    return true;
+  }
+  
+  inline void Close()
+  {
+    if(m_pData)
+      UnmapViewOfFile(m_pData);
+    if(m_mapping)
+      CloseHandle(m_mapping);
+    if(m_file != INVALID_HANDLE_VALUE)
+      CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = nullptr;
+    m_pData = nullptr;
+    m_size = 0;
+    m_pIndex = nullptr;
+    m_blockCount = 0;
+  }
+  
+  inline bool IsOpen() const
+  {
+    return m_pData != nullptr;
+  }
+  
+  inline size_t BlockCount() const
+  {
+    return m_blockCount;
+  }
+  
+  inline IndexEntry Block(const size_t index) const
+  {
+    assert(index < m_blockCount);
+    IndexEntry entry;
+    memcpy(&entry, m_pIndex + index * sizeof(IndexEntry), sizeof(entry));
+    return entry;
+  }
+  
+  // Index of the block holding the given offset of the uncompressed pcap stream.
+  inline size_t BlockByRawOffset(const uint64_t rawOffset) const
+  {
+    size_t low = 0;
+    size_t high = m_blockCount;
+    while(high - low > 1)
+    {
+      const size_t middle = (low + high) / 2;
+      if(Block(middle).rawOffset <= rawOffset)
+        low = middle;
+      else
+        high = middle;
+    }
+    return low;
+  }
+  
+  // Decompresses one block into raw, which is reused across calls to avoid allocations.
+  inline bool BlockRead(const size_t index, std::vector<char>& raw) const
+  {
+    const IndexEntry entry = Block(index);
+    if(entry.fileOffset > m_size ||
+      m_size - entry.fileOffset < sizeof(BRAWcapCompressedWriter::BlockHeader) + entry.storedSize)
+      return false;
+    
+    // The block header must agree with the index, both come from the file.
+    BRAWcapCompressedWriter::BlockHeader header;
+    memcpy(&header, m_pData + entry.fileOffset, sizeof(header));
+    if(header.storedSize != entry.storedSize || header.rawSize != entry.rawSize)
+      return false;
+    const char* pStored = m_pData + entry.fileOffset + sizeof(header);
+    raw.resize(entry.rawSize);
+    if(header.flags & BRAWcapCompressedWriter::BLOCK_FLAG_STORED)
+    {
+      if(entry.storedSize != entry.rawSize)
+        return false;
+      memcpy(raw.data(), pStored, entry.rawSize);
+      return true;
+    }
+    return BRAWcapLz::Decompress(pStored, entry.storedSize, raw.data(), raw.size()) == entry.rawSize;
+  }
+  
+  // Visits the packets of an already decompressed block, packets point into raw.
+  template<typename Visitor>
+  inline size_t BlockForEach(const size_t index, const std::vector<char>& raw, Visitor&& visitor) const
+  {
+    const IndexEntry entry = Block(index);
+    size_t offset = entry.rawOffset ? 0 : sizeof(BRAWcapPcapWriter::FileHeader);
+    size_t visited = 0;
+    while(offset + sizeof(BRAWcapPcapWriter::RecordHeader) <= raw.size())
+    {
+      BRAWcapPcapWriter::RecordHeader header;
+      memcpy(&header, raw.data() + offset, sizeof(header));
+      const size_t payload = offset + sizeof(header);
+      if(payload + header.includedLength > raw.size())
+        break;
+      
+      const BRAWcapFilePacket packet(raw.data() + payload, header.includedLength, header.originalLength,
+        header.seconds * 1000000000ULL + header.nanoseconds, 1, 0, entry.rawOffset + offset);
+      offset = payload + header.includedLength;
+      ++visited;
+      // Visitors returning bool can stop the walk early by returning false.
+      if constexpr(std::is_same<decltype(visitor(std::declval<const BRAWcapFilePacket&>())), bool>::value)
+      {
+        if(!visitor(packet))
+          break;
+      }
+      else
+        visitor(packet);
+    }
+    return visited;
+  }
+  
+  template<typename Visitor>
+  inline size_t ForEach(Visitor&& visitor) const
+  {
+    std::vector<char> raw;
+    size_t visited = 0;
+    for(size_t index = 0; index < m_blockCount; ++index)
+    {
+      if(BlockRead(index, raw))
+        visited += BlockForEach(index, raw, visitor);
+    }
+    return visited;
+  }
+  
+  // Decompresses and visits blocks on numThreads threads, visitor(packet, blockIndex) is called in parallel for
+  // different blocks and in order within a block.
+  template<typename Visitor>
+  inline size_t ForEachParallel(Visitor&& visitor, size_t numThreads = 0) const
+  {
+    if(!numThreads)
+      numThreads = std::max(1U, std::thread::hardware_concurrency());
+    
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> visited(0);
+    std::vector<std::thread> threads;
+    for(size_t thread = 0; thread < numThreads; ++thread)
+    {
+      threads.emplace_back([this, &visitor, &next, &visited]()
+      {
+        std::vector<char> raw;
+        for(size_t index = next++; index < m_blockCount; index = next++)
+        {
+          if(!BlockRead(index, raw))
+            continue;
+          visited += BlockForEach(index, raw, [&visitor, index](const BRAWcapFilePacket& packet)
+          {
+            return visitor(packet, index);
+          });
+        }
+      });
+    }
+    for(auto& thread : threads)
+      thread.join();
+    return visited;
+  }
+  
+private:
+  inline bool HeaderParse()
+  {
+    BRAWcapCompressedWriter::FileHeader header;
+    BRAWcapCompressedWriter::Trailer trailer;
+    memcpy(&header, m_pData, sizeof(header));
+    memcpy(&trailer, m_pData + m_size - sizeof(trailer), sizeof(trailer));
+    if(header.magic != BRAWcapCompressedWriter::MAGIC || header.version != BRAWcapCompressedWriter::VERSION ||
+      header.codec != BRAWcapCompressedWriter::CODEC_LZ4_BLOCK || trailer.magic != BRAWcapCompressedWriter::MAGIC)
+      return false;
+    if(trailer.indexOffset + trailer.blockCount * sizeof(IndexEntry) + sizeof(trailer) != m_size)
+      return false;
+    
+    m_pIndex = m_pData + trailer.indexOffset;
+    m_blockCount = static_cast<size_t>(trailer.blockCount);
+    return true;
+  }
+  
+private:
+  HANDLE m_file;
+  HANDLE m_mapping;
+  const char* m_pData;
+  uint64_t m_size;
+  const char* m_pIndex;
+  size_t m_blockCount;
+};
+
+#endif // BRAWCAP_COMPRESSED_READER_HPP
@@ -0,0 +1,427 @@
+/**
+ * @file brawcap_compressed_writer.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Compressed Writer (block compressed pcap container).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_COMPRESSED_WRITER_HPP
+#define BRAWCAP_COMPRESSED_WRITER_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet_view.hpp"
+#include "brawcap_file_packet.hpp"
+#include "brawcap_file_writer.hpp"
+#include "brawcap_pcap_writer.hpp"
+#include "brawcap_ring.hpp"
+#include "brawcap_lz.hpp"
+#endif // INCLUDES
+
+// Writes a nanosecond pcap stream cut into independent blocks at record boundaries. Blocks are compressed on a pool
+// of worker threads and written in order by an I/O thread, a block index at the end of the file allows random and
+// parallel access (see BRAWcapCompressedReader). Like BRAWcapDump the capture side never waits: without a free block
+// the packet is dropped and counted.
+class BRAWcapCompressedWriter
+{
+public:
+  static constexpr uint64_t MAGIC = 0x31305A4C43574242ULL; // "BBWCLZ01"
+  static constexpr uint32_t VERSION = 1;
+  static constexpr uint32_t CODEC_LZ4_BLOCK = 1;
+  static constexpr uint32_t BLOCK_FLAG_STORED = 0x1;
+  
+  struct Config
+  {
+    uint32_t blockSize = 1024 * 1024;
+    size_t threads = 0; // 0: hardware threads - 2
+    size_t blocksInFlight = 0; // 0: 4 per thread
+    uint32_t snapLength = BRAWCAP_PACKET_SIZE_MAX;
+  };
+  
+  struct Stats
+  {
+    uint64_t packetsWritten;
+    uint64_t packetsDropped;
+    uint64_t rawBytes;
+    uint64_t storedBytes;
+    uint64_t blocks;
+  };
+
+#pragma pack(push, 1)
+  struct FileHeader
+  {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t blockSize;
+    uint32_t codec;
+    uint32_t reserved;
+  };
+  
+  struct BlockHeader
+  {
+    uint32_t storedSize;
+    uint32_t rawSize;
+    uint32_t flags;
+    uint32_t reserved;
+  };
+  
+  struct IndexEntry
+  {
+    uint64_t fileOffset; // of the BlockHeader
+    uint64_t rawOffset; // inside the uncompressed pcap stream
+    uint32_t storedSize;
+    uint32_t rawSize;
+  };
+  
+  struct Trailer
+  {
+    uint64_t indexOffset;
+    uint64_t blockCount;
+    uint64_t magic;
+  };
+#pragma pack(pop)
+  
+public:
+  inline BRAWcapCompressedWriter()
+    : BRAWcapCompressedWriter(Config())
+  { }
+  
+  inline BRAWcapCompressedWriter(const Config& config)
+    : m_config(config), m_file(8 * 1024 * 1024), m_pCurrent(nullptr), m_rawOffset(0), m_running(false),
+      m_stopping(false), m_packetsWritten(0), m_packetsDropped(0), m_rawBytes(0), m_storedBytes(0),
+      m_blocksWritten(0)
+  {
+    assert(m_config.blockSize >= sizeof(BRAWcapPcapWriter::RecordHeader) + m_config.snapLength);
+    // Leave room for the receive and the I/O thread.
+    const size_t hardwareThreads = std::thread::hardware_concurrency();
+    if(!m_config.threads)
+      m_config.threads = hardwareThreads > 2 ? hardwareThreads - 2 : 1;
+    if(!m_config.blocksInFlight)
+      m_config.blocksInFlight = 4 * m_config.threads;
+    m_config.blocksInFlight = std::max<size_t>(m_config.blocksInFlight, 2);
+    
+    m_blocks = std::unique_ptr<Block[]>(new Block[m_config.blocksInFlight]);
+    m_pFree = std::make_unique<BRAWcapRing<Block*>>(m_config.blocksInFlight);
+    m_pCompress = std::make_unique<BRAWcapRing<Block*>>(m_config.blocksInFlight);
+    m_pOrdered = std::make_unique<BRAWcapRing<Block*>>(m_config.blocksInFlight);
+    for(size_t index = 0; index < m_config.blocksInFlight; ++index)
+    {
+      Block& block = m_blocks[index];
+      block.raw.resize(m_config.blockSize);
+      block.stored.resize(BRAWcapLz::CompressBound(m_config.blockSize));
+      m_pFree->TryPush(&block);
+    }
+  }
+  
+  inline ~BRAWcapCompressedWriter()
+  {
+    if(IsOpen())
+      Close();
+  }
+  
+  BRAWcapCompressedWriter(const BRAWcapCompressedWriter&) = delete;
+  BRAWcapCompressedWriter& operator=(const BRAWcapCompressedWriter&) = delete;
+  
+  inline bool Open(const std::string& path)
+  {
+    assert(!m_running);
+    if(!m_file.Open(path))
+      return false;
+    
+    FileHeader header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.blockSize = m_config.blockSize;
+    header.codec = CODEC_LZ4_BLOCK;
+    m_file.Write(&header, sizeof(header));
+    m_index.clear();
+    m_rawOffset = 0;
+    
+    // The raw stream is a regular nanosecond pcap file, the first block carries its header.
+    const bool acquired = m_pFree->TryPop(m_pCurrent);
+    assert(acquired);
+    BRAWcapPcapWriter::FileHeader pcapHeader = {};
+    pcapHeader.magic = BRAWcapPcapWriter::MAGIC_NANOSECONDS;
+    pcapHeader.versionMajor = 2;
+    pcapHeader.versionMinor = 4;
+    pcapHeader.snapLength = m_config.snapLength;
+    pcapHeader.linkType = BRAWcapPcapWriter::LINKTYPE_ETHERNET;
+    memcpy(m_pCurrent->raw.data(), &pcapHeader, sizeof(pcapHeader));
+    m_pCurrent->used = sizeof(pcapHeader);
+    
+    m_stopping = false;
+    m_running = true;
+    for(size_t index = 0; index < m_config.threads; ++index)
+      m_workers.emplace_back(&BRAWcapCompressedWriter::CompressLoop, this);
+    m_ioThread = std::thread(&BRAWcapCompressedWriter::IoLoop, this);
+    return true;
+  }
+  
+  inline bool Close()
+  {
+    assert(m_running);
+    {
+      std::lock_guard<std::mutex> localLock(m_captureLock);
+      if(m_pCurrent && m_pCurrent->used)
+        BlockSubmit(m_pCurrent);
+      else if(m_pCurrent)
+        m_pFree->TryPush(m_pCurrent);
+      m_pCurrent = nullptr;
+    }
+    m_stopping = true;
+    m_ioThread.join();
+    for(auto& worker : m_workers)
+      worker.join();
+    m_workers.clear();
+    m_running = false;
+    
+    Trailer trailer = {};
+    trailer.indexOffset = m_file.Size();
+    trailer.blockCount = m_index.size();
+    trailer.magic = MAGIC;
+    if(!m_index.empty())
+      m_file.Write(m_index.data(), m_index.size() * sizeof(IndexEntry));
+    m_file.Write(&trailer, sizeof(trailer));
+    return m_file.Close();
+  }
+  
+  inline bool IsOpen() const
+  {
+    return m_file.IsOpen();
+  }
+  
+  inline bool Write(const BRAWcapPacketView& packet)
+  {
+    std::lock_guard<std::mutex> localLock(m_captureLock);
+    return RecordAppend(packet);
+  }
+  
+  inline bool Write(const BRAWcapFilePacket& packet)
+  {
+    std::lock_guard<std::mutex> localLock(m_captureLock);
+    return RecordAppend(packet);
+  }
+  
+  inline size_t Write(BRAWcapBuffer& buffer)
+  {
+    std::lock_guard<std::mutex> localLock(m_captureLock);
+    size_t written = 0;
+    buffer.ForEach([this, &written](const BRAWcapPacketView& packet)
+    {
+      written += RecordAppend(packet);
+    });
+    return written;
+  }
+  
+  // Receive callback for BRAWcapReceive::ReceiveStart(), pass the writer as user pointer.
+  inline static void ReceiveBufferComplete(BRAWcapBuffer& buffer, brawcap_status_t status, void* pUser)
+  {
+    if(BRAWCAP_SUCCESS(status))
+      reinterpret_cast<BRAWcapCompressedWriter*>(pUser)->Write(buffer);
+  }
+  
+  inline void Statistics(Stats& stats) const
+  {
+    stats.packetsWritten = m_packetsWritten.load(std::memory_order_relaxed);
+    stats.packetsDropped = m_packetsDropped.load(std::memory_order_relaxed);
+    stats.rawBytes = m_rawBytes.load(std::memory_order_relaxed);
+    stats.storedBytes = m_storedBytes.load(std::memory_order_relaxed);
+    stats.blocks = m_blocksWritten.load(std::memory_order_relaxed);
+  }
+  
+private:
+  struct Block
+  {
+    std::vector<char> raw;
+    std::vector<char> stored;
+    size_t used;
+    size_t storedSize;
+    uint32_t flags;
+    std::atomic<bool> done;
+    
+    inline Block()
+      : used(0), storedSize(0), flags(0), done(false)
+    { }
+  };
+  
+private:
+  // Capture side, called with m_captureLock held.
+  template<typename Packet>
+  inline bool RecordAppend(const Packet& packet)
+  {
+    const uint32_t length = std::min<uint32_t>(packet.PayloadLength(), m_config.snapLength);
+    const size_t size = sizeof(BRAWcapPcapWriter::RecordHeader) + length;
+    if(m_pCurrent && m_pCurrent->used + size > m_config.blockSize)
+    {
+      BlockSubmit(m_pCurrent);
+      m_pCurrent = nullptr;
+    }
+    if(!m_pCurrent && !m_pFree->TryPop(m_pCurrent))
+    {
+      m_packetsDropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    
+    uint64_t seconds = 0;
+    uint32_t nanoseconds = 0;
+    packet.TimestampNs(seconds, nanoseconds);
+    BRAWcapPcapWriter::RecordHeader header;
+    header.seconds = static_cast<uint32_t>(seconds);
+    header.nanoseconds = nanoseconds;
+    header.includedLength = length;
+    header.originalLength = std::max<uint32_t>(packet.LengthOnWire(), length);
+    
+    char* pRecord = m_pCurrent->raw.data() + m_pCurrent->used;
+    memcpy(pRecord, &header, sizeof(header));
+    memcpy(pRecord + sizeof(header), packet.Payload(), length);
+    m_pCurrent->used += size;
+    m_packetsWritten.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  
+  inline void BlockSubmit(Block* pBlock)
+  {
+    pBlock->done.store(false, std::memory_order_relaxed);
+    // Both rings have room for every block, order of m_pOrdered is the file order.
+    bool pushed = m_pOrdered->TryPush(pBlock);
+    pushed &= m_pCompress->TryPush(pBlock);
+    assert(pushed);
+  }
+  
+  // Worker / I/O side
+  
+  inline static void Idle(uint32_t& idleRounds)
+  {
+    if(++idleRounds < 64)
+      std::this_thread::yield();
+    else
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  
+  inline void CompressLoop()
+  {
+    uint32_t idleRounds = 0;
+    Block* pBlock = nullptr;
+    for(;;)
+    {
+      if(!m_pCompress->TryPop(pBlock))
+      {
+        if(m_stopping.load(std::memory_order_acquire) && m_pCompress->Empty())
+          break;
+        Idle(idleRounds);
+        continue;
+      }
+      
+      idleRounds = 0;
+      pBlock->storedSize = BRAWcapLz::Compress(pBlock->raw.data(), pBlock->used, pBlock->stored.data(),
+        pBlock->stored.size());
+      pBlock->flags = 0;
+      if(!pBlock->storedSize || pBlock->storedSize >= pBlock->used)
+      {
+        pBlock->storedSize = pBlock->used;
+        pBlock->flags = BLOCK_FLAG_STORED;
+      }
+      pBlock->done.store(true, std::memory_order_release);
+    }
+  }
+  
+  inline void IoLoop()
+  {
+    uint32_t idleRounds = 0;
+    Block* pBlock = nullptr;
+    for(;;)
+    {
+      if(!m_pOrdered->TryPop(pBlock))
+      {
+        if(m_stopping.load(std::memory_order_acquire) && m_pOrdered->Empty())
+          break;
+        Idle(idleRounds);
+        continue;
+      }
+      
+      idleRounds = 0;
+      while(!pBlock->done.load(std::memory_order_acquire))
+        Idle(idleRounds);
+      
+      IndexEntry entry;
+      entry.fileOffset = m_file.Size();
+      entry.rawOffset = m_rawOffset;
+      entry.storedSize = static_cast<uint32_t>(pBlock->storedSize);
+      entry.rawSize = static_cast<uint32_t>(pBlock->used);
+      m_index.push_back(entry);
+      
+      BlockHeader header = {};
+      header.storedSize = entry.storedSize;
+      header.rawSize = entry.rawSize;
+      header.flags = pBlock->flags;
+      m_file.Write(&header, sizeof(header));
+      m_file.Write(pBlock->flags & BLOCK_FLAG_STORED ? pBlock->raw.data() : pBlock->stored.data(),
+        pBlock->storedSize);
+      
+      m_rawOffset += pBlock->used;
+      m_rawBytes.fetch_add(pBlock->used, std::memory_order_relaxed);
+      m_storedBytes.fetch_add(pBlock->storedSize, std::memory_order_relaxed);
+      m_blocksWritten.fetch_add(1, std::memory_order_relaxed);
+      pBlock->used = 0;
+      m_pFree->TryPush(pBlock);
+    }
+  }
+  
+private:
+  Config m_config;
+  BRAWcapFileWriter m_file;
+  std::unique_ptr<Block[]> m_blocks;
+  std::unique_ptr<BRAWcapRing<Block*>> m_pFree;
+  std::unique_ptr<BRAWcapRing<Block*>> m_pCompress;
+  std::unique_ptr<BRAWcapRing<Block*>> m_pOrdered;
+  
+  std::mutex m_captureLock;
+  Block* m_pCurrent;
+  
+  std::vector<IndexEntry> m_index;
+  uint64_t m_rawOffset;
+  std::vector<std::thread> m_workers;
+  std::thread m_ioThread;
+  std::atomic<bool> m_running;
+  std::atomic<bool> m_stopping;
+  
+  std::atomic<uint64_t> m_packetsWritten;
+  std::atomic<uint64_t> m_packetsDropped;
+  std::atomic<uint64_t> m_rawBytes;
+  std::atomic<uint64_t> m_storedBytes;
+  std::atomic<uint64_t> m_blocksWritten;
+};
+
+#endif // BRAWCAP_COMPRESSED_WRITER_HPP
@@ -0,0 +1,462 @@
+/**
+ * @file brawcap_dump.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Dump (asynchronous capture to disk).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_DUMP_HPP
+#define BRAWCAP_DUMP_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet_view.hpp"
+#include "brawcap_pcap_writer.hpp"
+#include "brawcap_ring.hpp"
+#endif // INCLUDES
+
+// Replacement for BRAWCAP_RX_MODE_DUMP: receive buffers are serialized as nanosecond pcap into page aligned staging
+// blocks on the capture thread, a dedicated I/O thread writes the blocks and rotates the files. The capture thread
+// never waits for the disk, if no staging block is free the packet is dropped and accounted for.
+class BRAWcapDump
+{
+public:
+  static constexpr size_t SECTOR_SIZE = 4096;
+  
+  struct Config
+  {
+    std::string pathPrefix;
+    size_t blockSize = 4 * 1024 * 1024;
+    size_t blockCount = 16;
+    uint64_t rotateBytes = 0; // 0: no size based rotation
+    uint32_t rotateSeconds = 0; // 0: no time based rotation
+    bool noBuffering = true; // bypass the system file cache
+    uint32_t snapLength = BRAWCAP_PACKET_SIZE_MAX;
+  };
+  
+  struct Stats
+  {
+    uint64_t packetsWritten;
+    uint64_t bytesWritten;
+    uint64_t packetsDropped; // staging blocks exhausted, I/O fell behind
+    uint64_t bytesDropped;
+    uint64_t buffersAffected; // receive buffers with at least one dropped packet
+    uint64_t blocksWritten;
+    uint64_t filesWritten;
+    uint64_t ioErrors;
+    size_t blocksPending;
+    size_t blocksPendingMax;
+  };
+  
+public:
+  inline BRAWcapDump(const Config& config)
+    : m_config(config), m_pBlockMemory(nullptr, &_aligned_free), m_freeBlocks(config.blockCount),
+      m_fullBlocks(config.blockCount), m_pCurrent(nullptr), m_pNext(nullptr), m_fileIndex(0), m_fileBytes(0),
+      m_rotatePending(false), m_running(false), m_stopping(false), m_file(INVALID_HANDLE_VALUE),
+      m_ioFileIndex(0), m_ioFileBytes(0), m_ioFilePhysicalBytes(0), m_packetsWritten(0), m_bytesWritten(0),
+      m_packetsDropped(0), m_bytesDropped(0), m_buffersAffected(0), m_blocksWritten(0), m_filesWritten(0),
+      m_ioErrors(0), m_blocksPendingMax(0)
+  {
+    assert(!m_config.pathPrefix.empty() && m_config.blockCount >= 2);
+    m_config.blockSize = std::max(m_config.blockSize, static_cast<size_t>(2 * SECTOR_SIZE));
+    m_config.blockSize = (m_config.blockSize + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1);
+    assert(m_config.blockSize >= sizeof(BRAWcapPcapWriter::RecordHeader) + m_config.snapLength);
+    
+    m_pBlockMemory.reset(reinterpret_cast<char*>(_aligned_malloc(m_config.blockSize * m_config.blockCount,
+      SECTOR_SIZE)));
+    assert(m_pBlockMemory);
+    m_blocks.resize(m_config.blockCount);
+    for(size_t index = 0; index < m_blocks.size(); ++index)
+    {
+      m_blocks[index].pData = m_pBlockMemory.get() + index * m_config.blockSize;
+      m_blocks[index].used = 0;
+      m_blocks[index].fileIndex = 0;
+      m_freeBlocks.TryPush(&m_blocks[index]);
+    }
+  }
+  
+  inline ~BRAWcapDump()
+  {
+    if(m_running)
+      Stop();
+  }
+  
+  BRAWcapDump(const BRAWcapDump&) = delete;
+  BRAWcapDump& operator=(const BRAWcapDump&) = delete;
+  
+  inline void Start()
+  {
+    assert(!m_running);
+    m_stopping = false;
+    m_running = true;
+    {
+      std::lock_guard<std::mutex> localLock(m_captureLock);
+      const bool begun = FileBegin();
+      assert(begun);
+    }
+    m_ioThread = std::thread(&BRAWcapDump::IoLoop, this);
+  }
+  
+  // Hands the partially filled block to the I/O thread and waits until everything is on disk.
+  inline void Stop()
+  {
+    assert(m_running);
+    {
+      std::lock_guard<std::mutex> localLock(m_captureLock);
+      if(m_pCurrent && m_pCurrent->used)
+        BlockSubmit(m_pCurrent);
+      else if(m_pCurrent)
+        m_freeBlocks.TryPush(m_pCurrent);
+      if(m_pNext)
+        m_freeBlocks.TryPush(m_pNext);
+      m_pCurrent = nullptr;
+      m_pNext = nullptr;
+    }
+    m_stopping = true;
+    m_ioThread.join();
+    m_running = false;
+  }
+  
+  // Starts a new file with the next packet.
+  inline void Rotate()
+  {
+    m_rotatePending = true;
+  }
+  
+  inline std::string FileName(const uint32_t fileIndex) const
+  {
+    char suffix[16] = { '\0' };
+    snprintf(suffix, sizeof(suffix), "_%05u.pcap", fileIndex);
+    return m_config.pathPrefix + suffix;
+  }
+  
+  // Serializes all packets of the buffer, returns the number of packets accepted.
+  inline size_t Write(BRAWcapBuffer& buffer)
+  {
+    std::lock_guard<std::mutex> localLock(m_captureLock);
+    if(m_config.rotateSeconds && std::chrono::steady_clock::now() - m_fileStart >=
+      std::chrono::seconds(m_config.rotateSeconds))
+      m_rotatePending = true;
+    
+    size_t accepted = 0;
+    size_t dropped = 0;
+    buffer.ForEach([this, &accepted, &dropped](const BRAWcapPacketView& packet)
+    {
+      if(PacketAppend(packet))
+        ++accepted;
+      else
+        ++dropped;
+    });
+    
+    if(dropped)
+      m_buffersAffected.fetch_add(1, std::memory_order_relaxed);
+    return accepted;
+  }
+  
+  // Receive callback for BRAWcapReceive::ReceiveStart(), pass the dump as user pointer.
+  inline static void ReceiveBufferComplete(BRAWcapBuffer& buffer, brawcap_status_t status, void* pUser)
+  {
+    if(BRAWCAP_SUCCESS(status))
+      reinterpret_cast<BRAWcapDump*>(pUser)->Write(buffer);
+  }
+  
+  inline void Statistics(Stats& stats) const
+  {
+    stats.packetsWritten = m_packetsWritten.load(std::memory_order_relaxed);
+    stats.bytesWritten = m_bytesWritten.load(std::memory_order_relaxed);
+    stats.packetsDropped = m_packetsDropped.load(std::memory_order_relaxed);
+    stats.bytesDropped = m_bytesDropped.load(std::memory_order_relaxed);
+    stats.buffersAffected = m_buffersAffected.load(std::memory_order_relaxed);
+    stats.blocksWritten = m_blocksWritten.load(std::memory_order_relaxed);
+    stats.filesWritten = m_filesWritten.load(std::memory_order_relaxed);
+    stats.ioErrors = m_ioErrors.load(std::memory_order_relaxed);
+    stats.blocksPending = m_fullBlocks.Size();
+    stats.blocksPendingMax = m_blocksPendingMax.load(std::memory_order_relaxed);
+  }
+  
+private:
+  struct Block
+  {
+    char* pData;
+    size_t used;
+    uint32_t fileIndex;
+  };
+  
+private:
+  // Capture side, called with m_captureLock held.
+  
+  inline bool FileBegin()
+  {
+    if(!m_pCurrent && !m_freeBlocks.TryPop(m_pCurrent))
+      return false;
+    if(m_pCurrent->used)
+    {
+      Block* pNext = m_pNext;
+      if(!pNext && !m_freeBlocks.TryPop(pNext))
+        return false;
+      BlockSubmit(m_pCurrent);
+      m_pCurrent = pNext;
+      m_pNext = nullptr;
+    }
+    
+    m_pCurrent->fileIndex = m_fileIndex++;
+    m_pCurrent->used = 0;
+    
+    BRAWcapPcapWriter::FileHeader header = {};
+    header.magic = BRAWcapPcapWriter::MAGIC_NANOSECONDS;
+    header.versionMajor = 2;
+    header.versionMinor = 4;
+    header.snapLength = m_config.snapLength;
+    header.linkType = BRAWcapPcapWriter::LINKTYPE_ETHERNET;
+    memcpy(m_pCurrent->pData, &header, sizeof(header));
+    m_pCurrent->used = sizeof(header);
+    
+    m_fileBytes = sizeof(header);
+    m_fileStart = std::chrono::steady_clock::now();
+    m_rotatePending = false;
+    return true;
+  }
+  
+  inline bool PacketAppend(const BRAWcapPacketView& packet)
+  {
+    const uint32_t captured = std::min<uint32_t>(packet.PayloadLength(), m_config.snapLength);
+    const size_t length = sizeof(BRAWcapPcapWriter::RecordHeader) + captured;
+    
+    const bool rotateSize = m_config.rotateBytes && m_fileBytes + length > m_config.rotateBytes &&
+      m_fileBytes > sizeof(BRAWcapPcapWriter::FileHeader);
+    if((m_rotatePending || rotateSize || !m_pCurrent) && !FileContinue(rotateSize))
+      return PacketDrop(length);
+    
+    // Records may span into the next block, so secure it before writing anything.
+    if(m_config.blockSize - m_pCurrent->used < length && !m_pNext && !m_freeBlocks.TryPop(m_pNext))
+      return PacketDrop(length);
+    
+    uint64_t seconds = 0;
+    uint32_t nanoseconds = 0;
+    packet.TimestampNs(seconds, nanoseconds);
+    BRAWcapPcapWriter::RecordHeader header;
+    header.seconds = static_cast<uint32_t>(seconds);
+    header.nanoseconds = nanoseconds;
+    header.includedLength = captured;
+    header.originalLength = std::max<uint32_t>(packet.LengthOnWire(), captured);
+    
+    Append(&header, sizeof(header));
+    Append(packet.Payload(), captured);
+    m_fileBytes += length;
+    m_packetsWritten.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  
+  inline bool FileContinue(const bool rotateSize)
+  {
+    if(m_rotatePending || rotateSize)
+      return FileBegin();
+    // Previous block was submitted exactly full and no spare was available at that time.
+    if(!m_freeBlocks.TryPop(m_pCurrent))
+      return false;
+    m_pCurrent->fileIndex = m_fileIndex - 1;
+    m_pCurrent->used = 0;
+    return true;
+  }
+  
+  inline bool PacketDrop(const size_t length)
+  {
+    m_packetsDropped.fetch_add(1, std::memory_order_relaxed);
+    m_bytesDropped.fetch_add(length, std::memory_order_relaxed);
+    return false;
+  }
+  
+  inline void Append(const void* pData, size_t length)
+  {
+    const char* pBytes = reinterpret_cast<const char*>(pData);
+    while(length)
+    {
+      const size_t chunk = std::min(length, m_config.blockSize - m_pCurrent->used);
+      memcpy(m_pCurrent->pData + m_pCurrent->used, pBytes, chunk);
+      m_pCurrent->used += chunk;
+      pBytes += chunk;
+      length -= chunk;
+      
+      if(m_pCurrent->used < m_config.blockSize)
+        continue;
+      
+      const uint32_t fileIndex = m_pCurrent->fileIndex;
+      BlockSubmit(m_pCurrent);
+      m_pCurrent = m_pNext;
+      m_pNext = nullptr;
+      if(m_pCurrent || m_freeBlocks.TryPop(m_pCurrent))
+      {
+        m_pCurrent->fileIndex = fileIndex;
+        m_pCurrent->used = 0;
+      }
+      assert(m_pCurrent || !length);
+    }
+  }
+  
+  inline void BlockSubmit(Block* pBlock)
+  {
+    const bool pushed = m_fullBlocks.TryPush(pBlock);
+    assert(pushed);
+    const size_t pending = m_fullBlocks.Size();
+    if(pending > m_blocksPendingMax.load(std::memory_order_relaxed))
+      m_blocksPendingMax.store(pending, std::memory_order_relaxed);
+  }
+  
+private:
+  // I/O side
+  
+  inline void IoLoop()
+  {
+    uint32_t idleRounds = 0;
+    Block* pBlock = nullptr;
+    for(;;)
+    {
+      if(!m_fullBlocks.TryPop(pBlock))
+      {
+        if(m_stopping.load(std::memory_order_acquire) && m_fullBlocks.Empty())
+          break;
+        if(++idleRounds < 16)
+          std::this_thread::yield();
+        else
+          std::this_thread::sleep_for(std::chrono::microseconds(200));
+        continue;
+      }
+      
+      idleRounds = 0;
+      if(m_file == INVALID_HANDLE_VALUE || pBlock->fileIndex != m_ioFileIndex)
+      {
+        IoFileFinish();
+        IoFileOpen(pBlock->fileIndex);
+      }
+      IoBlockWrite(*pBlock);
+      pBlock->used = 0;
+      m_freeBlocks.TryPush(pBlock);
+    }
+    IoFileFinish();
+  }
+  
+  inline void IoFileOpen(const uint32_t fileIndex)
+  {
+    const DWORD flags = FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN |
+      (m_config.noBuffering ? FILE_FLAG_NO_BUFFERING : 0);
+    m_file = CreateFileA(FileName(fileIndex).c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, flags,
+      nullptr);
+    if(m_file == INVALID_HANDLE_VALUE)
+      m_ioErrors.fetch_add(1, std::memory_order_relaxed);
+    m_ioFileIndex = fileIndex;
+    m_ioFileBytes = 0;
+    m_ioFilePhysicalBytes = 0;
+  }
+  
+  inline void IoBlockWrite(Block& block)
+  {
+    if(m_file == INVALID_HANDLE_VALUE)
+      return;
+    
+    // Unbuffered I/O requires sector multiples: pad the tail, the file is cut to its logical size on close.
+    size_t size = block.used;
+    if(m_config.noBuffering)
+    {
+      size = (size + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1);
+      memset(block.pData + block.used, 0, size - block.used);
+    }
+    
+    DWORD written = 0;
+    if(!WriteFile(m_file, block.pData, static_cast<DWORD>(size), &written, nullptr) || written != size)
+    {
+      m_ioErrors.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    m_ioFileBytes += block.used;
+    m_ioFilePhysicalBytes += size;
+    m_bytesWritten.fetch_add(block.used, std::memory_order_relaxed);
+    m_blocksWritten.fetch_add(1, std::memory_order_relaxed);
+  }
+  
+  inline void IoFileFinish()
+  {
+    if(m_file == INVALID_HANDLE_VALUE)
+      return;
+    
+    if(m_ioFilePhysicalBytes != m_ioFileBytes)
+    {
+      LARGE_INTEGER position;
+      position.QuadPart = static_cast<LONGLONG>(m_ioFileBytes);
+      if(!SetFilePointerEx(m_file, position, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+        m_ioErrors.fetch_add(1, std::memory_order_relaxed);
+    }
+    CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+    m_filesWritten.fetch_add(1, std::memory_order_relaxed);
+  }
+  
+private:
+  Config m_config;
+  std::unique_ptr<char, void(*)(void*)> m_pBlockMemory;
+  std::vector<Block> m_blocks;
+  BRAWcapRing<Block*> m_freeBlocks;
+  BRAWcapRing<Block*> m_fullBlocks;
+  
+  // Capture side
+  std::mutex m_captureLock;
+  Block* m_pCurrent;
+  Block* m_pNext;
+  uint32_t m_fileIndex;
+  uint64_t m_fileBytes;
+  std::chrono::steady_clock::time_point m_fileStart;
+  std::atomic<bool> m_rotatePending;
+  std::atomic<bool> m_running;
+  std::atomic<bool> m_stopping;
+  std::thread m_ioThread;
+  
+  // I/O side
+  HANDLE m_file;
+  uint32_t m_ioFileIndex;
+  uint64_t m_ioFileBytes;
+  uint64_t m_ioFilePhysicalBytes;
+  
+  std::atomic<uint64_t> m_packetsWritten;
+  std::atomic<uint64_t> m_bytesWritten;
+  std::atomic<uint64_t> m_packetsDropped;
+  std::atomic<uint64_t> m_bytesDropped;
+  std::atomic<uint64_t> m_buffersAffected;
+  std::atomic<uint64_t> m_blocksWritten;
+  std::atomic<uint64_t> m_filesWritten;
+  std::atomic<uint64_t> m_ioErrors;
+  std::atomic<size_t> m_blocksPendingMax;
+};
+
+#endif // BRAWCAP_DUMP_HPP
@@ -0,0 +1,281 @@
+/**
+ * @file brawcap_fanout.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Fanout (hash based distribution of packets to per-core queues).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_FANOUT_HPP
+#define BRAWCAP_FANOUT_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cassert>
+// CPP
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_receive.hpp"
+#include "brawcap_filter.hpp"
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet_view.hpp"
+#include "brawcap_ring.hpp"
+#include "brawcap_flow.hpp"
+#endif // INCLUDES
+
+class BRAWcapFanout
+{
+public:
+  using PacketCallback = void(*)(const BRAWcapPacketView& packet, size_t queueIndex, void* pUser);
+  
+  struct QueueStats
+  {
+    uint64_t packets;
+    uint64_t packetsDropped;
+    size_t depth;
+    size_t depthMax;
+    size_t capacity;
+  };
+  
+  struct Stats
+  {
+    uint64_t packetsDistributed;
+    uint64_t packetsDropped;
+    uint64_t buffersDropped;
+    double imbalance; // busiest queue / average queue, 1.0 is perfectly balanced
+    std::vector<QueueStats> queues;
+  };
+  
+public:
+  // The filter is applied before the pool is created, so BRAWcapReceive::PAYLOAD_SIZE_SNAP sizes the pool by its
+  // capture length.
+  inline BRAWcapFanout(const std::string& name, const brawcap_packet_size_t maxPacketPayloadSize,
+    const brawcap_buffer_packet_count_t packetsPerBuffer, const size_t numBuffers, const size_t numQueues,
+    const size_t queueCapacity, const BRAWcapFilter* pFilter = nullptr)
+    : m_receive(name), m_batches(new Batch[numBuffers]), m_freeBatches(numBuffers), m_callback(nullptr),
+      m_pUser(nullptr), m_running(false), m_stopping(false), m_buffersDropped(0)
+  {
+    assert(numQueues && queueCapacity);
+    if(pFilter)
+      m_receive.ReceiveFilterSet(*pFilter);
+    m_receive.ReceiveBufferPoolCreate(maxPacketPayloadSize, packetsPerBuffer, numBuffers);
+    for(size_t index = 0; index < numBuffers; ++index)
+      m_freeBatches.TryPush(&m_batches[index]);
+    for(size_t index = 0; index < numQueues; ++index)
+      m_queues.push_back(std::make_unique<Queue>(queueCapacity));
+  }
+  
+  inline ~BRAWcapFanout()
+  {
+    if(m_running)
+      Stop();
+  }
+  
+  BRAWcapFanout(const BRAWcapFanout&) = delete;
+  BRAWcapFanout& operator=(const BRAWcapFanout&) = delete;
+  
+  inline BRAWcapReceive& Receiver()
+  {
+    return m_receive;
+  }
+  
+  inline size_t QueueCount() const
+  {
+    return m_queues.size();
+  }
+  
+  // firstCpu >= 0 pins queue i to CPU firstCpu + i, the affinity mask covers CPUs 0 to 63.
+  inline void Start(PacketCallback callback, void* pUser, const int firstCpu = -1)
+  {
+    assert(callback && !m_running);
+    assert(firstCpu < 0 || firstCpu + m_queues.size() <= 64);
+    m_callback = callback;
+    m_pUser = pUser;
+    m_stopping = false;
+    m_running = true;
+    for(size_t index = 0; index < m_queues.size(); ++index)
+    {
+      const int cpu = firstCpu < 0 ? -1 : firstCpu + static_cast<int>(index);
+      m_queues[index]->worker = std::thread(&BRAWcapFanout::QueueLoop, this, index, cpu);
+    }
+    m_receive.ReceivePooledStart(ReceiveBufferComplete, this);
+  }
+  
+  inline void Stop()
+  {
+    assert(m_running);
+    m_receive.ReceiveStop();
+    m_stopping = true;
+    for(auto& pQueue : m_queues)
+      pQueue->worker.join();
+    m_running = false;
+    m_callback = nullptr;
+    m_pUser = nullptr;
+  }
+  
+  inline void Statistics(Stats& stats) const
+  {
+    stats.packetsDistributed = 0;
+    stats.packetsDropped = 0;
+    stats.buffersDropped = m_buffersDropped.load(std::memory_order_relaxed);
+    stats.queues.resize(m_queues.size());
+    
+    uint64_t busiest = 0;
+    for(size_t index = 0; index < m_queues.size(); ++index)
+    {
+      const Queue& queue = *m_queues[index];
+      QueueStats& queueStats = stats.queues[index];
+      queueStats.packets = queue.packets.load(std::memory_order_relaxed);
+      queueStats.packetsDropped = queue.packetsDropped.load(std::memory_order_relaxed);
+      queueStats.depth = queue.ring.Size();
+      queueStats.depthMax = queue.depthMax.load(std::memory_order_relaxed);
+      queueStats.capacity = queue.ring.Capacity();
+      stats.packetsDistributed += queueStats.packets;
+      stats.packetsDropped += queueStats.packetsDropped;
+      busiest = std::max(busiest, queueStats.packets);
+    }
+    
+    const double average = static_cast<double>(stats.packetsDistributed) / m_queues.size();
+    stats.imbalance = average > 0 ? busiest / average : 1.0;
+  }
+  
+private:
+  struct Batch
+  {
+    BRAWcapBuffer* pBuffer;
+    std::atomic<uint32_t> references;
+  };
+  
+  struct PacketRef
+  {
+    brawcap_packet_t* pPacket;
+    Batch* pBatch;
+  };
+  
+  struct alignas(64) Queue
+  {
+    inline Queue(const size_t capacity)
+      : ring(capacity), packets(0), packetsDropped(0), depthMax(0)
+    { }
+    
+    BRAWcapRing<PacketRef> ring;
+    std::atomic<uint64_t> packets;
+    std::atomic<uint64_t> packetsDropped;
+    std::atomic<size_t> depthMax;
+    std::thread worker;
+  };
+  
+private:
+  // Runs on the receive thread: hash every packet and hand a reference to the owning queue. The buffer returns to the
+  // pool once the last queue has processed its last packet of it.
+  inline static void ReceiveBufferComplete(BRAWcapBuffer& buffer, brawcap_status_t status, void* pUser)
+  {
+    BRAWcapFanout* pFanout = reinterpret_cast<BRAWcapFanout*>(pUser);
+    Batch* pBatch = nullptr;
+    if(!BRAWCAP_SUCCESS(status) || !pFanout->m_freeBatches.TryPop(pBatch))
+    {
+      if(BRAWCAP_SUCCESS(status))
+        pFanout->m_buffersDropped.fetch_add(1, std::memory_order_relaxed);
+      pFanout->m_receive.ReceiveBufferRelease(buffer);
+      return;
+    }
+    
+    // Take one reference per packet up front (+1 guard) so consumers can never free the buffer while distributing.
+    pBatch->pBuffer = &buffer;
+    pBatch->references.store(buffer.Count() + 1, std::memory_order_relaxed);
+    
+    auto& queues = pFanout->m_queues;
+    uint32_t unused = 0;
+    buffer.ForEach([&](const BRAWcapPacketView& packet)
+    {
+      Queue& queue = *queues[BRAWcapFlow::Bucket(BRAWcapFlow::Hash(packet), queues.size())];
+      if(queue.ring.TryPush({ packet.Native(), pBatch }))
+        return;
+      queue.packetsDropped.fetch_add(1, std::memory_order_relaxed);
+      ++unused;
+    });
+    
+    for(auto& pQueue : queues)
+    {
+      const size_t depth = pQueue->ring.Size();
+      if(depth > pQueue->depthMax.load(std::memory_order_relaxed))
+        pQueue->depthMax.store(depth, std::memory_order_relaxed);
+    }
+    
+    pFanout->Unreference(pBatch, unused + 1);
+  }
+  
+  inline void Unreference(Batch* pBatch, const uint32_t count)
+  {
+    if(pBatch->references.fetch_sub(count, std::memory_order_acq_rel) != count)
+      return;
+    m_receive.ReceiveBufferRelease(*pBatch->pBuffer);
+    m_freeBatches.TryPush(pBatch);
+  }
+  
+  inline void QueueLoop(const size_t index, const int cpu)
+  {
+    if(cpu >= 0 && !SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu))
+      assert(false);
+    
+    Queue& queue = *m_queues[index];
+    uint32_t idleRounds = 0;
+    PacketRef ref;
+    for(;;)
+    {
+      if(queue.ring.TryPop(ref))
+      {
+        idleRounds = 0;
+        m_callback(BRAWcapPacketView(ref.pPacket), index, m_pUser);
+        queue.packets.fetch_add(1, std::memory_order_relaxed);
+        Unreference(ref.pBatch, 1);
+        continue;
+      }
+      
+      if(m_stopping.load(std::memory_order_acquire))
+        break;
+      
+      if(++idleRounds < 64)
+        std::this_thread::yield();
+      else
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  
+private:
+  BRAWcapReceive m_receive;
+  std::unique_ptr<Batch[]> m_batches;
+  BRAWcapRing<Batch*> m_freeBatches;
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  PacketCallback m_callback;
+  void* m_pUser;
+  std::atomic<bool> m_running;
+  std::atomic<bool> m_stopping;
+  std::atomic<uint64_t> m_buffersDropped;
+};
+
+#endif // BRAWCAP_FANOUT_HPP
@@ -0,0 +1,135 @@
+/**
+ * @file brawcap_file_packet.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper File Packet (view on a packet record inside a capture file).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_FILE_PACKET_HPP
+#define BRAWCAP_FILE_PACKET_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+// CPP
+#include <type_traits>
+#include <limits>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#endif // INCLUDES
+
+// Offers the accessors of BRAWcapPacketView for records of a mapped capture file, so analysis code written against
+// live buffers can be used on files as well.
+class BRAWcapFilePacket
+{
+public:
+  inline BRAWcapFilePacket()
+    : m_pPayload(nullptr), m_length(0), m_lengthOnWire(0), m_interfaceId(0), m_timestampNs(0),
+      m_resolutionNs(0), m_offset(0)
+  { }
+  
+  inline BRAWcapFilePacket(const char* pPayload, const uint32_t length, const uint32_t lengthOnWire,
+    const uint64_t timestampNs, const uint32_t resolutionNs, const uint32_t interfaceId, const uint64_t offset)
+    : m_pPayload(pPayload), m_length(length), m_lengthOnWire(lengthOnWire), m_interfaceId(interfaceId),
+      m_timestampNs(timestampNs), m_resolutionNs(resolutionNs), m_offset(offset)
+  { }
+  
+  inline bool Valid() const
+  {
+    return m_pPayload != nullptr;
+  }
+  
+  inline const char* Payload() const
+  {
+    return m_pPayload;
+  }
+  
+  inline uint32_t PayloadLength() const
+  {
+    return m_length;
+  }
+  
+  // Same signature as the live packets. Records beyond the range of brawcap_packet_size_t are reported clamped,
+  // PayloadLength() has the full length.
+  inline void PayloadRef(const char*& payload, brawcap_packet_size_t& length) const
+  {
+    payload = m_pPayload;
+    length = static_cast<brawcap_packet_size_t>(std::min<uint32_t>(m_length,
+      std::numeric_limits<brawcap_packet_size_t>::max()));
+  }
+  
+  inline uint32_t LengthOnWire() const
+  {
+    return m_lengthOnWire;
+  }
+  
+  inline void TimestampNs(uint64_t& seconds, uint32_t& nanoseconds) const
+  {
+    seconds = m_timestampNs / 1000000000ULL;
+    nanoseconds = static_cast<uint32_t>(m_timestampNs % 1000000000ULL);
+  }
+  
+  inline void TimestampUs(uint64_t& seconds, uint32_t& microseconds) const
+  {
+    seconds = m_timestampNs / 1000000000ULL;
+    microseconds = static_cast<uint32_t>(m_timestampNs % 1000000000ULL / 1000);
+  }
+  
+  inline void TimestampMs(uint64_t& seconds, uint32_t& milliseconds) const
+  {
+    seconds = m_timestampNs / 1000000000ULL;
+    milliseconds = static_cast<uint32_t>(m_timestampNs % 1000000000ULL / 1000000);
+  }
+  
+  inline uint64_t TimestampTotalNs() const
+  {
+    return m_timestampNs;
+  }
+  
+  inline uint32_t TimestampResolutionNs() const
+  {
+    return m_resolutionNs;
+  }
+  
+  inline uint32_t InterfaceId() const
+  {
+    return m_interfaceId;
+  }
+  
+  // Byte offset of the record (pcap record header / pcapng block) inside the file.
+  inline uint64_t FileOffset() const
+  {
+    return m_offset;
+  }
+  
+private:
+  const char* m_pPayload;
+  uint32_t m_length;
+  uint32_t m_lengthOnWire;
+  uint32_t m_interfaceId;
+  uint64_t m_timestampNs;
+  uint32_t m_resolutionNs;
+  uint64_t m_offset;
+};
+
+static_assert(std::is_trivially_copyable<BRAWcapFilePacket>::value, "BRAWcapFilePacket must stay trivially copyable.");
+
+#endif // BRAWCAP_FILE_PACKET_HPP
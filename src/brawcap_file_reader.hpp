@@ -0,0 +1,523 @@
+/**
+ * @file brawcap_file_reader.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper File Reader (memory mapped pcap/pcapng access).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_FILE_READER_HPP
+#define BRAWCAP_FILE_READER_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_file_packet.hpp"
+#endif // INCLUDES
+
+// Maps a pcap or pcapng capture file read only and walks its records in place. pcapng support covers a single
+// section in host byte order, which is what every writer on the capture host produces.
+class BRAWcapFileReader
+{
+public:
+  enum class Format
+  {
+    NONE,
+    PCAP,
+    PCAPNG
+  };
+  
+  static constexpr uint32_t PCAP_MAGIC_MICROSECONDS = 0xA1B2C3D4;
+  static constexpr uint32_t PCAP_MAGIC_NANOSECONDS = 0xA1B23C4D;
+  static constexpr uint32_t PCAPNG_BLOCK_SHB = 0x0A0D0D0A;
+  static constexpr uint32_t PCAPNG_BLOCK_IDB = 0x00000001;
+  static constexpr uint32_t PCAPNG_BLOCK_PB = 0x00000002;
+  static constexpr uint32_t PCAPNG_BLOCK_SPB = 0x00000003;
+  static constexpr uint32_t PCAPNG_BLOCK_EPB = 0x00000006;
+  static constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+  // Fraction bits of binary timestamps converted in one multiply, 2^34 * 10^9 < 2^64.
+  static constexpr int BINARY_FRACTION_BITS_MAX = 34;
+  
+public:
+  inline BRAWcapFileReader()
+    : m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr), m_pData(nullptr), m_size(0), m_format(Format::NONE),
+      m_dataStart(0), m_linkType(0), m_snapLength(0), m_pcapNanoseconds(false), m_interfacesComplete(false)
+  { }
+  
+  inline ~BRAWcapFileReader()
+  {
+    if(IsOpen())
+      Close();
+  }
+  
+  BRAWcapFileReader(const BRAWcapFileReader&) = delete;
+  BRAWcapFileReader& operator=(const BRAWcapFileReader&) = delete;
+  
+  inline bool Open(const std::string& path)
+  {
+    assert(!IsOpen());
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(m_file == INVALID_HANDLE_VALUE)
+      return false;
+    
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(m_file, &size) || !size.QuadPart)
+    {
+      Close();
+      return false;
+    }
+    m_size = static_cast<uint64_t>(size.QuadPart);
+    
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(m_mapping)
+      m_pData = reinterpret_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if(!m_pData || !HeaderParse())
+    {
+      Close();
+      return false;
+    }
+    return true;
+  }
+  
+  inline void Close()
+  {
+    if(m_pData)
+      UnmapViewOfFile(m_pData);
+    if(m_mapping)
+      CloseHandle(m_mapping);
+    if(m_file != INVALID_HANDLE_VALUE)
+      CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+    m_mapping = nullptr;
+    m_pData = nullptr;
+    m_size = 0;
+    m_format = Format::NONE;
+    m_interfaces.clear();
+    m_interfacesAll.clear();
+    m_interfacesComplete = false;
+  }
+  
+  inline bool IsOpen() const
+  {
+    return m_pData != nullptr;
+  }
+  
+  inline Format FileFormat() const
+  {
+    return m_format;
+  }
+  
+  inline uint64_t Size() const
+  {
+    return m_size;
+  }
+  
+  inline const char* Data() const
+  {
+    return m_pData;
+  }
+  
+  // Offset of the first record behind the file header.
+  inline uint64_t DataStart() const
+  {
+    return m_dataStart;
+  }
+  
+  inline uint32_t LinkType() const
+  {
+    return m_linkType;
+  }
+  
+  template<typename Visitor>
+  inline size_t ForEach(Visitor&& visitor)
+  {
+    return ForEachRange(std::forward<Visitor>(visitor), m_dataStart, m_size);
+  }
+  
+  // Visits every record which starts inside [begin, end). begin must be a record boundary (see ResyncPoints()).
+  template<typename Visitor>
+  inline size_t ForEachRange(Visitor&& visitor, uint64_t begin, const uint64_t end)
+  {
+    assert(IsOpen());
+    size_t visited = 0;
+    BRAWcapFilePacket packet;
+    uint64_t offset = begin;
+    while(offset < end)
+    {
+      uint64_t next = 0;
+      const bool isPacket = m_format == Format::PCAP ? PcapRecord(offset, packet, next) :
+        PcapngBlock(offset, packet, next);
+      if(!next)
+        break;
+      offset = next;
+      if(!isPacket)
+        continue;
+      
+      ++visited;
+      // Visitors returning bool can stop the walk early by returning false.
+      if constexpr(std::is_same<decltype(visitor(std::declval<const BRAWcapFilePacket&>())), bool>::value)
+      {
+        if(!visitor(static_cast<const BRAWcapFilePacket&>(packet)))
+          break;
+      }
+      else
+        visitor(static_cast<const BRAWcapFilePacket&>(packet));
+    }
+    return visited;
+  }
+  
+  // Splits the file into chunks of about equal size, each starting at a record boundary. The result holds
+  // chunks + 1 ascending offsets, the last one being the file size. Chunks may end up empty.
+  inline std::vector<uint64_t> ResyncPoints(const size_t chunks)
+  {
+    assert(IsOpen() && chunks);
+    std::vector<uint64_t> points(chunks + 1, m_size);
+    points[0] = m_dataStart;
+    const uint64_t chunkSize = (m_size - m_dataStart) / chunks;
+    for(size_t index = 1; index < chunks; ++index)
+      points[index] = std::max(points[index - 1], Resync(m_dataStart + index * chunkSize));
+    return points;
+  }
+  
+  // Scans the file on numThreads threads, visitor(packet, chunkIndex) is called in parallel for different chunks
+  // and in file order within a chunk. Returns the number of visited packets.
+  template<typename Visitor>
+  inline size_t ForEachParallel(Visitor&& visitor, size_t numThreads = 0)
+  {
+    if(!numThreads)
+      numThreads = std::max(1U, std::thread::hardware_concurrency());
+    const std::vector<uint64_t> points = ResyncPoints(numThreads);
+    
+    std::atomic<size_t> visited(0);
+    std::vector<std::thread> threads;
+    for(size_t index = 0; index < numThreads; ++index)
+    {
+      threads.emplace_back([this, &visitor, &points, &visited, index]()
+      {
+        visited += ForEachRange([&visitor, index](const BRAWcapFilePacket& packet)
+        {
+          return visitor(packet, index);
+        }, points[index], points[index + 1]);
+      });
+    }
+    for(auto& thread : threads)
+      thread.join();
+    return visited;
+  }
+  
+private:
+  struct Interface
+  {
+    uint32_t linkType;
+    uint32_t resolutionNs;
+    bool binary;
+    uint8_t exponent; // 10^-exponent or 2^-exponent seconds per unit
+    int64_t offsetSeconds;
+  };
+  
+private:
+  template<typename T>
+  inline T Read(const uint64_t offset) const
+  {
+    T value;
+    memcpy(&value, m_pData + offset, sizeof(T));
+    return value;
+  }
+  
+  inline bool HeaderParse()
+  {
+    if(m_size < 24)
+      return false;
+    
+    const uint32_t magic = Read<uint32_t>(0);
+    if(magic == PCAP_MAGIC_MICROSECONDS || magic == PCAP_MAGIC_NANOSECONDS)
+    {
+      m_format = Format::PCAP;
+      m_pcapNanoseconds = magic == PCAP_MAGIC_NANOSECONDS;
+      m_snapLength = Read<uint32_t>(16);
+      m_linkType = Read<uint32_t>(20);
+      m_dataStart = 24;
+      return true;
+    }
+    
+    if(magic != PCAPNG_BLOCK_SHB || Read<uint32_t>(8) != PCAPNG_BYTE_ORDER_MAGIC || !BlockPlausible(0))
+      return false;
+    
+    m_format = Format::PCAPNG;
+    m_dataStart = Read<uint32_t>(4);
+    
+    // Collect the interfaces in front of the first packet, they cover the usual file layout.
+    uint64_t offset = m_dataStart;
+    while(BlockPlausible(offset))
+    {
+      const uint32_t type = Read<uint32_t>(offset);
+      const uint32_t length = Read<uint32_t>(offset + 4);
+      if(type == PCAPNG_BLOCK_EPB || type == PCAPNG_BLOCK_SPB || type == PCAPNG_BLOCK_PB)
+        break;
+      if(type == PCAPNG_BLOCK_IDB)
+        m_interfaces.push_back(InterfaceParse(offset, length));
+      offset += length;
+    }
+    m_linkType = m_interfaces.empty() ? 0 : m_interfaces.front().linkType;
+    return true;
+  }
+  
+  inline Interface InterfaceParse(const uint64_t offset, const uint32_t length) const
+  {
+    Interface entry = {};
+    entry.exponent = 6;
+    entry.resolutionNs = 1000;
+    if(length < 20)
+      return entry;
+    entry.linkType = Read<uint16_t>(offset + 8);
+    
+    uint64_t option = offset + 16;
+    const uint64_t end = offset + length - 4;
+    while(option + 4 <= end)
+    {
+      const uint16_t code = Read<uint16_t>(option);
+      const uint16_t optionLength = Read<uint16_t>(option + 2);
+      if(!code || option + 4 + optionLength > end)
+        break;
+      if(code == 9 && optionLength >= 1)
+      {
+        // Binary resolutions below 2^-63 do not fit the 64 bit units, the option is ignored.
+        const uint8_t value = Read<uint8_t>(option + 4);
+        if(!(value & 0x80) || (value & 0x7F) < 64)
+        {
+          entry.binary = (value & 0x80) != 0;
+          entry.exponent = value & 0x7F;
+        }
+      }
+      else if(code == 14 && optionLength >= 8)
+        entry.offsetSeconds = Read<int64_t>(option + 4);
+      option += 4 + ((optionLength + 3) & ~3U);
+    }
+    
+    entry.resolutionNs = 1;
+    if(!entry.binary)
+      for(int digit = entry.exponent; digit < 9; ++digit)
+        entry.resolutionNs *= 10;
+    return entry;
+  }
+  
+  // Interfaces declared behind the first packet are only known after a walk over all block headers, which is done
+  // once and only if such an interface is referenced.
+  inline const Interface* InterfaceLookup(const uint32_t id)
+  {
+    if(id < m_interfaces.size())
+      return &m_interfaces[id];
+    
+    if(!m_interfacesComplete.load(std::memory_order_acquire))
+    {
+      std::lock_guard<std::mutex> localLock(m_interfacesLock);
+      if(!m_interfacesComplete.load(std::memory_order_relaxed))
+      {
+        uint64_t offset = m_dataStart;
+        while(BlockPlausible(offset))
+        {
+          const uint32_t length = Read<uint32_t>(offset + 4);
+          if(Read<uint32_t>(offset) == PCAPNG_BLOCK_IDB)
+            m_interfacesAll.push_back(InterfaceParse(offset, length));
+          offset += length;
+        }
+        m_interfacesComplete.store(true, std::memory_order_release);
+      }
+    }
+    return id < m_interfacesAll.size() ? &m_interfacesAll[id] : nullptr;
+  }
+  
+  inline static uint64_t UnitsToNanoseconds(const Interface& entry, const uint64_t units)
+  {
+    uint64_t nanoseconds = 0;
+    if(entry.binary)
+    {
+      // Fraction bits beyond BINARY_FRACTION_BITS_MAX are below a nanosecond and dropped first.
+      const uint64_t mask = (1ULL << entry.exponent) - 1;
+      const int drop = std::max(0, entry.exponent - BINARY_FRACTION_BITS_MAX);
+      nanoseconds = (units >> entry.exponent) * 1000000000ULL +
+        ((((units & mask) >> drop) * 1000000000ULL) >> (entry.exponent - drop));
+    }
+    else if(entry.exponent <= 9)
+    {
+      nanoseconds = units;
+      for(int digit = entry.exponent; digit < 9; ++digit)
+        nanoseconds *= 10;
+    }
+    else
+    {
+      nanoseconds = units;
+      for(int digit = 9; digit < entry.exponent; ++digit)
+        nanoseconds /= 10;
+    }
+    return nanoseconds + entry.offsetSeconds * 1000000000LL;
+  }
+  
+  inline bool PcapPlausible(const uint64_t offset) const
+  {
+    if(offset + 16 > m_size)
+      return false;
+    const uint32_t fraction = Read<uint32_t>(offset + 4);
+    const uint32_t included = Read<uint32_t>(offset + 8);
+    const uint32_t original = Read<uint32_t>(offset + 12);
+    const uint32_t snapLength = m_snapLength ? m_snapLength : 262144;
+    return fraction < (m_pcapNanoseconds ? 1000000000U : 1000000U) && included <= snapLength &&
+      included <= original && original <= 262144 && offset + 16 + included <= m_size;
+  }
+  
+  inline bool BlockPlausible(const uint64_t offset) const
+  {
+    if(offset + 12 > m_size)
+      return false;
+    const uint32_t length = Read<uint32_t>(offset + 4);
+    return length >= 12 && !(length & 3) && offset + length <= m_size &&
+      Read<uint32_t>(offset + length - 4) == length;
+  }
+  
+  inline bool PcapRecord(const uint64_t offset, BRAWcapFilePacket& packet, uint64_t& next) const
+  {
+    next = 0;
+    if(!PcapPlausible(offset))
+      return false;
+    
+    const uint64_t seconds = Read<uint32_t>(offset);
+    const uint32_t fraction = Read<uint32_t>(offset + 4);
+    const uint32_t included = Read<uint32_t>(offset + 8);
+    const uint64_t timestampNs = seconds * 1000000000ULL + (m_pcapNanoseconds ? fraction : fraction * 1000ULL);
+    packet = BRAWcapFilePacket(m_pData + offset + 16, included, Read<uint32_t>(offset + 12), timestampNs,
+      m_pcapNanoseconds ? 1 : 1000, 0, offset);
+    next = offset + 16 + included;
+    return true;
+  }
+  
+  inline bool PcapngBlock(const uint64_t offset, BRAWcapFilePacket& packet, uint64_t& next)
+  {
+    next = 0;
+    if(!BlockPlausible(offset))
+      return false;
+    
+    const uint32_t type = Read<uint32_t>(offset);
+    const uint32_t length = Read<uint32_t>(offset + 4);
+    next = offset + length;
+    
+    uint32_t interfaceId = 0;
+    uint64_t units = 0;
+    uint32_t included = 0;
+    uint32_t original = 0;
+    uint64_t payload = 0;
+    if(type == PCAPNG_BLOCK_EPB && length >= 32)
+    {
+      interfaceId = Read<uint32_t>(offset + 8);
+      units = (static_cast<uint64_t>(Read<uint32_t>(offset + 12)) << 32) | Read<uint32_t>(offset + 16);
+      included = Read<uint32_t>(offset + 20);
+      original = Read<uint32_t>(offset + 24);
+      payload = offset + 28;
+    }
+    else if(type == PCAPNG_BLOCK_PB && length >= 32)
+    {
+      interfaceId = Read<uint16_t>(offset + 8);
+      units = (static_cast<uint64_t>(Read<uint32_t>(offset + 12)) << 32) | Read<uint32_t>(offset + 16);
+      included = Read<uint32_t>(offset + 20);
+      original = Read<uint32_t>(offset + 24);
+      payload = offset + 28;
+    }
+    else if(type == PCAPNG_BLOCK_SPB && length >= 16)
+    {
+      original = Read<uint32_t>(offset + 8);
+      included = std::min<uint32_t>(original, length - 16);
+      payload = offset + 12;
+    }
+    else
+      return false;
+    
+    if(payload + included > offset + length - 4)
+      return false;
+    
+    const Interface* pInterface = InterfaceLookup(interfaceId);
+    const uint64_t timestampNs = pInterface && type != PCAPNG_BLOCK_SPB ? UnitsToNanoseconds(*pInterface, units) : 0;
+    packet = BRAWcapFilePacket(m_pData + payload, included, original, timestampNs,
+      pInterface ? pInterface->resolutionNs : 0, interfaceId, offset);
+    return true;
+  }
+  
+  // Finds the first record boundary at or behind offset by checking that a chain of records parses consistently.
+  inline uint64_t Resync(uint64_t offset) const
+  {
+    static constexpr int CHAIN = 4;
+    if(m_format == Format::PCAPNG)
+      offset = m_dataStart + ((offset - m_dataStart + 3) & ~3ULL);
+    
+    const uint64_t step = m_format == Format::PCAPNG ? 4 : 1;
+    for(; offset < m_size; offset += step)
+    {
+      uint64_t candidate = offset;
+      int chain = 0;
+      for(; chain < CHAIN && candidate < m_size; ++chain)
+      {
+        if(m_format == Format::PCAP)
+        {
+          if(!PcapPlausible(candidate))
+            break;
+          candidate += 16 + Read<uint32_t>(candidate + 8);
+        }
+        else
+        {
+          if(!BlockPlausible(candidate))
+            break;
+          candidate += Read<uint32_t>(candidate + 4);
+        }
+      }
+      if(chain == CHAIN || candidate == m_size)
+        return offset;
+    }
+    return m_size;
+  }
+  
+private:
+  HANDLE m_file;
+  HANDLE m_mapping;
+  const char* m_pData;
+  uint64_t m_size;
+  Format m_format;
+  uint64_t m_dataStart;
+  uint32_t m_linkType;
+  uint32_t m_snapLength;
+  bool m_pcapNanoseconds;
+  std::vector<Interface> m_interfaces;
+  std::vector<Interface> m_interfacesAll;
+  std::mutex m_interfacesLock;
+  std::atomic<bool> m_interfacesComplete;
+};
+
+#endif // BRAWCAP_FILE_READER_HPP
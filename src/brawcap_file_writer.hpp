@@ -0,0 +1,161 @@
+/**
+ * @file brawcap_file_writer.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper File Writer (batched sequential file output).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_FILE_WRITER_HPP
+#define BRAWCAP_FILE_WRITER_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <string>
+#include <memory>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#endif // INCLUDES
+
+class BRAWcapFileWriter
+{
+public:
+  static constexpr size_t ALIGNMENT = 4096;
+  static constexpr size_t STAGING_SIZE_DEFAULT = 4 * 1024 * 1024;
+  
+public:
+  inline BRAWcapFileWriter(const size_t stagingSize = STAGING_SIZE_DEFAULT)
+    : m_file(INVALID_HANDLE_VALUE), m_stagingSize(std::max(ALIGNMENT, stagingSize)), m_stagingUsed(0),
+      m_pStaging(nullptr, &_aligned_free), m_bytesWritten(0), m_writes(0)
+  {
+    m_stagingSize = (m_stagingSize + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    m_pStaging.reset(reinterpret_cast<char*>(_aligned_malloc(m_stagingSize, ALIGNMENT)));
+    assert(m_pStaging);
+  }
+  
+  inline ~BRAWcapFileWriter()
+  {
+    if(IsOpen())
+      Close();
+  }
+  
+  BRAWcapFileWriter(const BRAWcapFileWriter&) = delete;
+  BRAWcapFileWriter& operator=(const BRAWcapFileWriter&) = delete;
+  
+  inline bool Open(const std::string& path)
+  {
+    assert(!IsOpen());
+    m_file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    m_stagingUsed = 0;
+    m_bytesWritten = 0;
+    m_writes = 0;
+    return IsOpen();
+  }
+  
+  inline bool Close()
+  {
+    assert(IsOpen());
+    const bool flushed = Flush();
+    CloseHandle(m_file);
+    m_file = INVALID_HANDLE_VALUE;
+    return flushed;
+  }
+  
+  inline bool IsOpen() const
+  {
+    return m_file != INVALID_HANDLE_VALUE;
+  }
+  
+  // Returns space for size bytes inside the staging buffer, which becomes part of the file with Commit(size).
+  // Returns nullptr if size exceeds the staging buffer or the file could not be written.
+  inline char* Reserve(const size_t size)
+  {
+    if(size > m_stagingSize)
+      return nullptr;
+    if(m_stagingUsed + size > m_stagingSize && !Flush())
+      return nullptr;
+    return m_pStaging.get() + m_stagingUsed;
+  }
+  
+  inline void Commit(const size_t size)
+  {
+    assert(m_stagingUsed + size <= m_stagingSize);
+    m_stagingUsed += size;
+  }
+  
+  inline bool Write(const void* pData, size_t size)
+  {
+    const char* pBytes = reinterpret_cast<const char*>(pData);
+    while(size)
+    {
+      if(m_stagingUsed == m_stagingSize && !Flush())
+        return false;
+      const size_t chunk = std::min(size, m_stagingSize - m_stagingUsed);
+      memcpy(m_pStaging.get() + m_stagingUsed, pBytes, chunk);
+      m_stagingUsed += chunk;
+      pBytes += chunk;
+      size -= chunk;
+    }
+    return true;
+  }
+  
+  inline bool Flush()
+  {
+    assert(IsOpen());
+    if(!m_stagingUsed)
+      return true;
+    
+    DWORD written = 0;
+    const bool success = WriteFile(m_file, m_pStaging.get(), static_cast<DWORD>(m_stagingUsed), &written, nullptr) &&
+      written == m_stagingUsed;
+    assert(success);
+    m_bytesWritten += written;
+    m_stagingUsed = 0;
+    ++m_writes;
+    return success;
+  }
+  
+  // Logical file size including data still pending in the staging buffer.
+  inline uint64_t Size() const
+  {
+    return m_bytesWritten + m_stagingUsed;
+  }
+  
+  inline uint64_t Writes() const
+  {
+    return m_writes;
+  }
+  
+private:
+  HANDLE m_file;
+  size_t m_stagingSize;
+  size_t m_stagingUsed;
+  std::unique_ptr<char, void(*)(void*)> m_pStaging;
+  uint64_t m_bytesWritten;
+  uint64_t m_writes;
+};
+
+#endif // BRAWCAP_FILE_WRITER_HPP
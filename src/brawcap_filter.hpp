@@ -31,6 +31,7 @@
 #include <cassert>
 // CPP
 #include <memory>
+#include <algorithm>
 
 // bRAWcap
 #include "libbrawcap.h"
@@ -132,6 +133,15 @@ public:
     return length;
   }
   
+  // Bytes the driver stores per packet with this filter applied, what buffers and capture files have to hold.
+  // With a non-zero capture byte offset these bytes start inside the frame, see BRAWcapReceive::ReceiveCaptureOffset.
+  inline brawcap_packet_size_t CaptureSnapLength() const
+  {
+    if(!m_captureByteLength)
+      return BRAWCAP_PACKET_SIZE_MAX;
+    return std::min<brawcap_packet_size_t>(m_captureByteLength, BRAWCAP_PACKET_SIZE_MAX);
+  }
+  
   inline void ByteFilterOffsetSet(const brawcap_packet_size_t offset)
   {
     brawcap_status_t status = brawcap_filter_mask_set(m_pFilter.get(), offset, m_byteLength, m_byteMask, m_byteIgnore);
@@ -0,0 +1,200 @@
+/**
+ * @file brawcap_flow.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Flow (symmetric 5-tuple hashing).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_FLOW_HPP
+#define BRAWCAP_FLOW_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE4_2__) || defined(__AVX__)
+#include <nmmintrin.h>
+#endif
+// CPP
+#include <array>
+#include <utility>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_packet_view.hpp"
+#endif // INCLUDES
+
+class BRAWcapFlow
+{
+public:
+  static constexpr uint16_t ETHER_TYPE_IPV4 = 0x0800;
+  static constexpr uint16_t ETHER_TYPE_IPV6 = 0x86DD;
+  static constexpr uint16_t ETHER_TYPE_VLAN = 0x8100;
+  static constexpr uint16_t ETHER_TYPE_QINQ = 0x88A8;
+  
+  static constexpr uint8_t IP_PROTOCOL_TCP = 6;
+  static constexpr uint8_t IP_PROTOCOL_UDP = 17;
+  static constexpr uint8_t IP_PROTOCOL_SCTP = 132;
+  
+public:
+  inline static uint32_t Crc32c(uint32_t crc, const void* pData, size_t length)
+  {
+    const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+#if defined(__SSE4_2__) || defined(__AVX__)
+    for(; length >= sizeof(uint32_t); length -= sizeof(uint32_t), pBytes += sizeof(uint32_t))
+    {
+      uint32_t value;
+      memcpy(&value, pBytes, sizeof(value));
+      crc = _mm_crc32_u32(crc, value);
+    }
+    for(; length; --length)
+      crc = _mm_crc32_u8(crc, *pBytes++);
+#else
+    const std::array<uint32_t, 256>& table = Crc32cTable();
+    for(; length; --length)
+      crc = table[(crc ^ *pBytes++) & 0xFF] ^ (crc >> 8);
+#endif
+    return crc;
+  }
+  
+  // Symmetric hash over the 5-tuple: both directions of a flow yield the same value.
+  // Non IP frames are hashed over MAC addresses and ether type, IPv4 fragments (MF or offset set) over the addresses.
+  inline static uint32_t Hash(const char* pFrame, const size_t length)
+  {
+    const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pFrame);
+    if(length < 14)
+      return Crc32c(~0U, pBytes, length);
+    
+    size_t offset = 12;
+    uint16_t etherType = Read16(pBytes + offset);
+    while((etherType == ETHER_TYPE_VLAN || etherType == ETHER_TYPE_QINQ) && offset + 6 <= length)
+    {
+      offset += 4;
+      etherType = Read16(pBytes + offset);
+    }
+    offset += 2;
+    
+    const uint8_t* pSource = nullptr;
+    const uint8_t* pDestination = nullptr;
+    size_t addressLength = 0;
+    uint8_t protocol = 0;
+    size_t l4Offset = 0;
+    
+    if(etherType == ETHER_TYPE_IPV4 && offset + 20 <= length)
+    {
+      const uint8_t* pIp = pBytes + offset;
+      addressLength = 4;
+      pSource = pIp + 12;
+      pDestination = pIp + 16;
+      protocol = pIp[9];
+      // Fragments hash on the addresses only, the ports are only in the first one and all of them must map to the
+      // same flow.
+      if(!(Read16(pIp + 6) & 0x3FFF))
+        l4Offset = offset + (pIp[0] & 0x0F) * 4;
+    }
+    else if(etherType == ETHER_TYPE_IPV6 && offset + 40 <= length)
+    {
+      const uint8_t* pIp = pBytes + offset;
+      addressLength = 16;
+      pSource = pIp + 8;
+      pDestination = pIp + 24;
+      protocol = pIp[6];
+      l4Offset = offset + 40;
+    }
+    else
+    {
+      // L2 only: order the MAC addresses to stay symmetric.
+      uint8_t key[14];
+      const bool swap = memcmp(pBytes, pBytes + 6, 6) > 0;
+      memcpy(key, pBytes + (swap ? 6 : 0), 6);
+      memcpy(key + 6, pBytes + (swap ? 0 : 6), 6);
+      memcpy(key + 12, pBytes + offset - 2, 2);
+      return Crc32c(~0U, key, sizeof(key));
+    }
+    
+    uint16_t sourcePort = 0;
+    uint16_t destinationPort = 0;
+    const bool hasPorts = protocol == IP_PROTOCOL_TCP || protocol == IP_PROTOCOL_UDP || protocol == IP_PROTOCOL_SCTP;
+    if(hasPorts && l4Offset && l4Offset + 4 <= length)
+    {
+      sourcePort = Read16(pBytes + l4Offset);
+      destinationPort = Read16(pBytes + l4Offset + 2);
+    }
+    
+    // Order the endpoints (address, port) so that A->B and B->A build the same key.
+    int order = memcmp(pSource, pDestination, addressLength);
+    if(!order)
+      order = sourcePort < destinationPort ? -1 : (sourcePort > destinationPort ? 1 : 0);
+    if(order > 0)
+    {
+      std::swap(pSource, pDestination);
+      std::swap(sourcePort, destinationPort);
+    }
+    
+    uint8_t key[2 * 16 + 2 * 2 + 1];
+    size_t keyLength = 0;
+    memcpy(key + keyLength, pSource, addressLength);
+    keyLength += addressLength;
+    memcpy(key + keyLength, pDestination, addressLength);
+    keyLength += addressLength;
+    memcpy(key + keyLength, &sourcePort, sizeof(sourcePort));
+    keyLength += sizeof(sourcePort);
+    memcpy(key + keyLength, &destinationPort, sizeof(destinationPort));
+    keyLength += sizeof(destinationPort);
+    key[keyLength++] = protocol;
+    return Crc32c(~0U, key, keyLength);
+  }
+  
+  inline static uint32_t Hash(const BRAWcapPacketView& packet)
+  {
+    return Hash(packet.Payload(), packet.PayloadLength());
+  }
+  
+  // Maps a hash onto [0, count) without a division.
+  inline static size_t Bucket(const uint32_t hash, const size_t count)
+  {
+    return static_cast<size_t>((static_cast<uint64_t>(hash) * count) >> 32);
+  }
+  
+private:
+  inline static uint16_t Read16(const uint8_t* pBytes)
+  {
+    return static_cast<uint16_t>((pBytes[0] << 8) | pBytes[1]);
+  }
+  
+  inline static const std::array<uint32_t, 256>& Crc32cTable()
+  {
+    static const std::array<uint32_t, 256> table = []()
+    {
+      std::array<uint32_t, 256> result = {};
+      for(uint32_t index = 0; index < 256; ++index)
+      {
+        uint32_t crc = index;
+        for(int bit = 0; bit < 8; ++bit)
+          crc = (crc >> 1) ^ (0x82F63B78 & (0U - (crc & 1)));
+        result[index] = crc;
+      }
+      return result;
+    }();
+    return table;
+  }
+};
+
+#endif // BRAWCAP_FLOW_HPP
@@ -0,0 +1,434 @@
+/**
+ * @file brawcap_frame_template.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Frame Template (patched frame generation).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_FRAME_TEMPLATE_HPP
+#define BRAWCAP_FRAME_TEMPLATE_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet.hpp"
+#endif // INCLUDES
+
+// Generates frames from a base frame which is built once. Per frame only the registered fields are patched:
+// counters and value ranges, random regions, and the IPv4 header and UDP checksums, which are updated
+// incrementally (RFC 1624) from the patched bytes only. Frames are rendered in batches with one loop per field over
+// the whole batch, simple enough for the compiler to vectorize.
+class BRAWcapFrameTemplate
+{
+public:
+  static constexpr size_t BATCH_SIZE = 64;
+  static constexpr size_t ETHERNET_HEADER_SIZE = 14;
+  static constexpr size_t VLAN_TAG_SIZE = 4;
+  static constexpr size_t IPV4_HEADER_SIZE = 20;
+  static constexpr size_t UDP_HEADER_SIZE = 8;
+  static constexpr size_t FIELD_WIDTH_MAX = 8;
+  static constexpr size_t OFFSET_NONE = SIZE_MAX;
+  
+public:
+  inline BRAWcapFrameTemplate(const char* pFrame, const size_t length)
+    : m_frame(pFrame, pFrame + length), m_ipv4Offset(OFFSET_NONE), m_udpOffset(OFFSET_NONE), m_sequence(0),
+      m_random(0x9E3779B97F4A7C15ULL)
+  {
+    assert(pFrame && length && length <= BRAWCAP_PACKET_SIZE_MAX);
+  }
+  
+  // Ethernet / optional VLAN tag / IPv4 / UDP frame of frameLength bytes (without FCS), payload zeroed. Both
+  // checksums are valid and registered for incremental update. Addresses and ports are in host byte order.
+  inline static BRAWcapFrameTemplate Ipv4Udp(const uint8_t dstMac[6], const uint8_t srcMac[6], const uint32_t srcIp,
+    const uint32_t dstIp, const uint16_t srcPort, const uint16_t dstPort, const size_t frameLength,
+    const uint16_t vlanId = 0)
+  {
+    const size_t ipv4Offset = ETHERNET_HEADER_SIZE + (vlanId ? VLAN_TAG_SIZE : 0);
+    const size_t udpOffset = ipv4Offset + IPV4_HEADER_SIZE;
+    assert(frameLength >= udpOffset + UDP_HEADER_SIZE && frameLength <= BRAWCAP_PACKET_SIZE_MAX);
+    
+    std::vector<char> frame(frameLength, 0);
+    uint8_t* pFrame = reinterpret_cast<uint8_t*>(frame.data());
+    memcpy(pFrame, dstMac, 6);
+    memcpy(pFrame + 6, srcMac, 6);
+    if(vlanId)
+    {
+      Store(pFrame + 12, 0x8100, 2, true);
+      Store(pFrame + 14, vlanId & 0x0FFF, 2, true);
+    }
+    Store(pFrame + ipv4Offset - 2, 0x0800, 2, true);
+    
+    uint8_t* pIp = pFrame + ipv4Offset;
+    pIp[0] = 0x45;
+    Store(pIp + 2, frameLength - ipv4Offset, 2, true);
+    Store(pIp + 6, 0x4000, 2, true); // don't fragment
+    pIp[8] = 64;
+    pIp[9] = 17;
+    Store(pIp + 12, srcIp, 4, true);
+    Store(pIp + 16, dstIp, 4, true);
+    
+    uint8_t* pUdp = pFrame + udpOffset;
+    Store(pUdp, srcPort, 2, true);
+    Store(pUdp + 2, dstPort, 2, true);
+    Store(pUdp + 4, frameLength - udpOffset, 2, true);
+    
+    BRAWcapFrameTemplate frameTemplate(frame.data(), frame.size());
+    frameTemplate.Ipv4ChecksumAdd(ipv4Offset, true);
+    frameTemplate.UdpChecksumAdd(ipv4Offset, udpOffset, true);
+    return frameTemplate;
+  }
+  
+  // Value field: first + (n % count) * step for frame n, count 0 counts without wrapping. Width is 1 to 8 bytes.
+  // Counters, MAC ranges (width 6) and address or port ranges are all expressed this way.
+  inline void FieldAdd(const size_t offset, const size_t width, const uint64_t first, const uint64_t step = 1,
+    const uint64_t count = 0, const bool bigEndian = true)
+  {
+    assert(width && width <= FIELD_WIDTH_MAX);
+    Patch patch = { Patch::Type::VALUE, offset, width, first, step, count, bigEndian };
+    PatchAdd(patch);
+  }
+  
+  // Region refilled with pseudo random bytes for every frame.
+  inline void RandomAdd(const size_t offset, const size_t length)
+  {
+    Patch patch = { Patch::Type::RANDOM, offset, length, 0, 0, 0, true };
+    PatchAdd(patch);
+  }
+  
+  // Registers the IPv4 header checksum for incremental update, recompute sets it from the base frame first.
+  inline void Ipv4ChecksumAdd(const size_t ipv4Offset, const bool recompute = false)
+  {
+    const size_t headerLength = (static_cast<uint8_t>(m_frame.at(ipv4Offset)) & 0x0F) * 4;
+    assert(headerLength >= IPV4_HEADER_SIZE && ipv4Offset + headerLength <= m_frame.size());
+    Checksum checksum = {};
+    checksum.fieldOffset = ipv4Offset + 10;
+    checksum.parityOffset = ipv4Offset;
+    checksum.ranges[0] = { ipv4Offset, ipv4Offset + headerLength };
+    checksum.rangeCount = 1;
+    m_ipv4Offset = ipv4Offset;
+    ChecksumAdd(checksum, recompute);
+  }
+  
+  // Registers the UDP checksum (pseudo header, header and payload). A checksum of 0 in the base frame means
+  // disabled and is left alone.
+  inline void UdpChecksumAdd(const size_t ipv4Offset, const size_t udpOffset, const bool recompute = false)
+  {
+    assert(udpOffset + UDP_HEADER_SIZE <= m_frame.size() && !((udpOffset - ipv4Offset) & 1));
+    const uint8_t* pFrame = reinterpret_cast<const uint8_t*>(m_frame.data());
+    const size_t udpLength = static_cast<size_t>(pFrame[udpOffset + 4] << 8 | pFrame[udpOffset + 5]);
+    assert(udpLength >= UDP_HEADER_SIZE && udpOffset + udpLength <= m_frame.size());
+    Checksum checksum = {};
+    checksum.fieldOffset = udpOffset + 6;
+    checksum.parityOffset = udpOffset;
+    checksum.ranges[0] = { ipv4Offset + 12, ipv4Offset + 20 };
+    checksum.ranges[1] = { udpOffset, udpOffset + udpLength };
+    checksum.rangeCount = 2;
+    checksum.udp = true;
+    // Protocol and UDP length complete the pseudo header, they are not patchable.
+    checksum.constant = pFrame[ipv4Offset + 9] + udpLength;
+    m_udpOffset = udpOffset;
+    ChecksumAdd(checksum, recompute);
+  }
+  
+  // Renders the next frames back to back into pOut (Length() bytes each).
+  inline void Render(char* pOut, size_t frames)
+  {
+    const size_t length = m_frame.size();
+    uint8_t* pFrames[BATCH_SIZE];
+    while(frames)
+    {
+      const size_t batch = std::min(frames, BATCH_SIZE);
+      for(size_t index = 0; index < batch; ++index)
+        pFrames[index] = reinterpret_cast<uint8_t*>(pOut) + index * length;
+      RenderBatch(pFrames, batch, false);
+      pOut += batch * length;
+      frames -= batch;
+    }
+  }
+  
+  // Appends up to count frames to the buffer, limited by its free capacity. Returns the number of frames added.
+  // The C API only appends by copying a packet, so the base frame is appended and the patches are then applied in
+  // place to the payload inside the buffer: one copy per frame, like Render().
+  inline size_t Fill(BRAWcapBuffer& buffer, size_t count = SIZE_MAX)
+  {
+    if(!m_pPacket)
+    {
+      m_pPacket = std::make_unique<BRAWcapPacket>(static_cast<brawcap_packet_size_t>(m_frame.size()));
+      m_pPacket->PayloadSet(m_frame.data(), static_cast<brawcap_packet_size_t>(m_frame.size()));
+    }
+    
+    count = std::min<size_t>(count, buffer.Capacity() - buffer.Count());
+    uint8_t* pFrames[BATCH_SIZE];
+    size_t added = 0;
+    while(added < count)
+    {
+      const size_t first = buffer.Count();
+      const size_t wanted = std::min(count - added, BATCH_SIZE);
+      size_t batch = 0;
+      for(; batch < wanted; ++batch)
+      {
+        if(!buffer.PushBack(*m_pPacket))
+          break;
+        // The payload lives in the user mode buffer memory, the API only hands it out as const.
+        pFrames[batch] = reinterpret_cast<uint8_t*>(const_cast<char*>(buffer.ViewAt(
+          static_cast<brawcap_buffer_packet_count_t>(first + batch)).Payload()));
+      }
+      RenderBatch(pFrames, batch, true);
+      added += batch;
+      if(batch < wanted)
+        break;
+    }
+    return added;
+  }
+  
+  // Next frame number, fields are evaluated for it.
+  inline void SequenceSet(const uint64_t sequence)
+  {
+    m_sequence = sequence;
+  }
+  
+  inline uint64_t Sequence() const
+  {
+    return m_sequence;
+  }
+  
+  inline size_t Length() const
+  {
+    return m_frame.size();
+  }
+  
+  inline const char* Frame() const
+  {
+    return m_frame.data();
+  }
+  
+  // Offsets registered by Ipv4Udp() or the checksum functions, OFFSET_NONE otherwise.
+  inline size_t Ipv4Offset() const
+  {
+    return m_ipv4Offset;
+  }
+  
+  inline size_t UdpOffset() const
+  {
+    return m_udpOffset;
+  }
+  
+private:
+  struct Patch
+  {
+    enum class Type
+    {
+      VALUE,
+      RANDOM
+    } type;
+    size_t offset;
+    size_t width;
+    uint64_t first;
+    uint64_t step;
+    uint64_t count;
+    bool bigEndian;
+  };
+  
+  struct Range
+  {
+    size_t begin;
+    size_t end;
+  };
+  
+  struct Checksum
+  {
+    size_t fieldOffset;
+    size_t parityOffset; // 16 bit words are aligned to this offset
+    Range ranges[2];
+    size_t rangeCount;
+    bool udp;
+    bool disabled; // UDP checksum 0 in the base frame
+    uint64_t constant;
+    uint64_t base; // ~checksum plus the complement of all patched base words
+    std::vector<Range> patched; // patched bytes inside the ranges
+  };
+  
+private:
+  inline static void Store(uint8_t* pOut, const uint64_t value, const size_t width, const bool bigEndian)
+  {
+    for(size_t index = 0; index < width; ++index)
+      pOut[bigEndian ? width - 1 - index : index] = static_cast<uint8_t>(value >> (8 * index));
+  }
+  
+  inline static uint16_t Fold(uint64_t sum)
+  {
+    while(sum >> 16)
+      sum = (sum & 0xFFFF) + (sum >> 16);
+    return static_cast<uint16_t>(sum);
+  }
+  
+  // Ones' complement sum of bytes [begin, end), words aligned to parityOffset.
+  inline static uint64_t Sum(const uint8_t* pFrame, size_t begin, const size_t end, const size_t parityOffset)
+  {
+    uint64_t sum = 0;
+    if(begin < end && ((begin - parityOffset) & 1))
+      sum += pFrame[begin++];
+    for(; begin + 1 < end; begin += 2)
+      sum += static_cast<uint64_t>(pFrame[begin]) << 8 | pFrame[begin + 1];
+    if(begin < end)
+      sum += static_cast<uint64_t>(pFrame[begin]) << 8;
+    return sum;
+  }
+  
+  inline void PatchAdd(const Patch& patch)
+  {
+    assert(patch.width && patch.offset + patch.width <= m_frame.size());
+    for(const Patch& other : m_patches)
+      assert(patch.offset + patch.width <= other.offset || other.offset + other.width <= patch.offset);
+    for(const Checksum& checksum : m_checksums)
+      assert(patch.offset + patch.width <= checksum.fieldOffset || checksum.fieldOffset + 2 <= patch.offset);
+    m_patches.push_back(patch);
+    for(Checksum& checksum : m_checksums)
+      ChecksumPrepare(checksum);
+    m_pPacket.reset();
+  }
+  
+  inline void ChecksumAdd(Checksum& checksum, const bool recompute)
+  {
+    uint8_t* pFrame = reinterpret_cast<uint8_t*>(m_frame.data());
+    if(recompute)
+    {
+      Store(pFrame + checksum.fieldOffset, 0, 2, true);
+      uint64_t sum = checksum.constant;
+      for(size_t index = 0; index < checksum.rangeCount; ++index)
+        sum += Sum(pFrame, checksum.ranges[index].begin, checksum.ranges[index].end, checksum.parityOffset);
+      uint16_t value = static_cast<uint16_t>(~Fold(sum));
+      if(checksum.udp && !value)
+        value = 0xFFFF;
+      Store(pFrame + checksum.fieldOffset, value, 2, true);
+    }
+    for(const Patch& patch : m_patches)
+      assert(patch.offset + patch.width <= checksum.fieldOffset || checksum.fieldOffset + 2 <= patch.offset);
+    m_checksums.push_back(checksum);
+    ChecksumPrepare(m_checksums.back());
+    m_pPacket.reset();
+  }
+  
+  // HC' = ~(~HC + ~m + m'): everything but the sum over the new bytes is constant per template.
+  inline void ChecksumPrepare(Checksum& checksum)
+  {
+    const uint8_t* pFrame = reinterpret_cast<const uint8_t*>(m_frame.data());
+    const uint16_t value = static_cast<uint16_t>(pFrame[checksum.fieldOffset] << 8 | pFrame[checksum.fieldOffset + 1]);
+    checksum.disabled = checksum.udp && !value;
+    checksum.base = static_cast<uint16_t>(~value);
+    checksum.patched.clear();
+    for(const Patch& patch : m_patches)
+    {
+      for(size_t index = 0; index < checksum.rangeCount; ++index)
+      {
+        const size_t begin = std::max(patch.offset, checksum.ranges[index].begin);
+        const size_t end = std::min(patch.offset + patch.width, checksum.ranges[index].end);
+        if(begin >= end)
+          continue;
+        checksum.patched.push_back({ begin, end });
+        checksum.base += static_cast<uint16_t>(~Fold(Sum(pFrame, begin, end, checksum.parityOffset)));
+      }
+    }
+  }
+  
+  inline uint64_t Random()
+  {
+    m_random ^= m_random >> 12;
+    m_random ^= m_random << 25;
+    m_random ^= m_random >> 27;
+    return m_random * 0x2545F4914F6CDD1DULL;
+  }
+  
+  // Patches the frames, baseCopied tells whether they already hold the base frame.
+  inline void RenderBatch(uint8_t* const* pFrames, const size_t batch, const bool baseCopied)
+  {
+    const size_t length = m_frame.size();
+    if(!baseCopied)
+    {
+      for(size_t index = 0; index < batch; ++index)
+        memcpy(pFrames[index], m_frame.data(), length);
+    }
+    
+    for(const Patch& patch : m_patches)
+    {
+      if(patch.type == Patch::Type::VALUE)
+      {
+        for(size_t index = 0; index < batch; ++index)
+        {
+          const uint64_t sequence = m_sequence + index;
+          const uint64_t value = patch.first + (patch.count ? sequence % patch.count : sequence) * patch.step;
+          Store(pFrames[index] + patch.offset, value, patch.width, patch.bigEndian);
+        }
+      }
+      else
+      {
+        for(size_t index = 0; index < batch; ++index)
+        {
+          uint8_t* pRegion = pFrames[index] + patch.offset;
+          for(size_t position = 0; position < patch.width; position += sizeof(uint64_t))
+          {
+            const uint64_t value = Random();
+            memcpy(pRegion + position, &value, std::min(sizeof(value), patch.width - position));
+          }
+        }
+      }
+    }
+    
+    for(const Checksum& checksum : m_checksums)
+    {
+      if(checksum.patched.empty() || checksum.disabled)
+        continue;
+      for(size_t index = 0; index < batch; ++index)
+      {
+        uint8_t* pFrame = pFrames[index];
+        uint64_t sum = checksum.base;
+        for(const Range& range : checksum.patched)
+          sum += Sum(pFrame, range.begin, range.end, checksum.parityOffset);
+        uint16_t value = static_cast<uint16_t>(~Fold(sum));
+        if(checksum.udp && !value)
+          value = 0xFFFF;
+        Store(pFrame + checksum.fieldOffset, value, 2, true);
+      }
+    }
+    m_sequence += batch;
+  }
+  
+private:
+  std::vector<char> m_frame;
+  std::vector<Patch> m_patches;
+  std::vector<Checksum> m_checksums;
+  size_t m_ipv4Offset;
+  size_t m_udpOffset;
+  uint64_t m_sequence;
+  uint64_t m_random;
+  std::unique_ptr<BRAWcapPacket> m_pPacket; // holds the base frame for Fill()
+};
+
+#endif // BRAWCAP_FRAME_TEMPLATE_HPP
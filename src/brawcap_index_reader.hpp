@@ -0,0 +1,164 @@
+/**
+ * @file brawcap_index_reader.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Index Reader (time and flow queries on capture file indices).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_INDEX_READER_HPP
+#define BRAWCAP_INDEX_READER_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_flow.hpp"
+#include "brawcap_index_writer.hpp"
+#endif // INCLUDES
+
+// Loads an index written by BRAWcapIndexWriter and answers which byte ranges of the capture file may contain
+// packets of a time window and/or flow. Range starts are record boundaries, suitable for
+// BRAWcapFileReader::ForEachRange().
+class BRAWcapIndexReader
+{
+public:
+  struct Range
+  {
+    uint64_t beginOffset;
+    uint64_t endOffset;
+  };
+  
+public:
+  inline BRAWcapIndexReader()
+    : m_header()
+  { }
+  
+  inline bool Open(const std::string& path)
+  {
+    m_data.clear();
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+      return false;
+    
+    LARGE_INTEGER size;
+    bool success = GetFileSizeEx(file, &size) && size.QuadPart >= static_cast<LONGLONG>(sizeof(m_header));
+    if(success)
+    {
+      m_data.resize(static_cast<size_t>(size.QuadPart));
+      size_t done = 0;
+      while(success && done < m_data.size())
+      {
+        DWORD read = 0;
+        const DWORD chunk = static_cast<DWORD>(std::min<size_t>(m_data.size() - done, 64 * 1024 * 1024));
+        success = ReadFile(file, m_data.data() + done, chunk, &read, nullptr) && read;
+        done += read;
+      }
+    }
+    CloseHandle(file);
+    
+    if(success)
+    {
+      memcpy(&m_header, m_data.data(), sizeof(m_header));
+      // The bloom lookup masks with bloomBits - 1, a power of two as the writer asserts.
+      success = m_header.magic == BRAWcapIndexWriter::MAGIC && m_header.version == BRAWcapIndexWriter::VERSION &&
+        m_header.bloomBits >= 64 && !(m_header.bloomBits & (m_header.bloomBits - 1)) &&
+        m_header.entrySize == sizeof(BRAWcapIndexWriter::EntryHeader) + m_header.bloomBits / 8;
+    }
+    if(!success)
+      m_data.clear();
+    return success;
+  }
+  
+  inline size_t Count() const
+  {
+    return m_data.empty() ? 0 : (m_data.size() - sizeof(m_header)) / m_header.entrySize;
+  }
+  
+  inline BRAWcapIndexWriter::EntryHeader Entry(const size_t index) const
+  {
+    assert(index < Count());
+    BRAWcapIndexWriter::EntryHeader entry;
+    memcpy(&entry, EntryData(index), sizeof(entry));
+    return entry;
+  }
+  
+  // Byte ranges of all blocks overlapping [startNs, endNs], adjacent blocks are merged.
+  inline std::vector<Range> QueryTime(const uint64_t startNs, const uint64_t endNs) const
+  {
+    return Query(startNs, endNs, nullptr);
+  }
+  
+  inline std::vector<Range> QueryFlow(const uint32_t flowHash, const uint64_t startNs = 0,
+    const uint64_t endNs = std::numeric_limits<uint64_t>::max()) const
+  {
+    return Query(startNs, endNs, &flowHash);
+  }
+  
+  // Looks up the flow of an example frame (either direction).
+  inline std::vector<Range> QueryFlow(const char* pFrame, const uint32_t length, const uint64_t startNs = 0,
+    const uint64_t endNs = std::numeric_limits<uint64_t>::max()) const
+  {
+    return QueryFlow(BRAWcapFlow::Hash(pFrame, length), startNs, endNs);
+  }
+  
+private:
+  inline const char* EntryData(const size_t index) const
+  {
+    return m_data.data() + sizeof(m_header) + index * m_header.entrySize;
+  }
+  
+  inline std::vector<Range> Query(const uint64_t startNs, const uint64_t endNs, const uint32_t* pFlowHash) const
+  {
+    std::vector<Range> ranges;
+    const size_t count = Count();
+    for(size_t index = 0; index < count; ++index)
+    {
+      const char* pEntry = EntryData(index);
+      BRAWcapIndexWriter::EntryHeader entry;
+      memcpy(&entry, pEntry, sizeof(entry));
+      if(entry.lastNs < startNs || entry.firstNs > endNs)
+        continue;
+      if(pFlowHash && !BRAWcapIndexWriter::BloomContains(reinterpret_cast<const uint8_t*>(pEntry + sizeof(entry)),
+        m_header.bloomBits, *pFlowHash))
+        continue;
+      
+      if(!ranges.empty() && ranges.back().endOffset == entry.beginOffset)
+        ranges.back().endOffset = entry.endOffset;
+      else
+        ranges.push_back({ entry.beginOffset, entry.endOffset });
+    }
+    return ranges;
+  }
+  
+private:
+  BRAWcapIndexWriter::FileHeader m_header;
+  std::vector<char> m_data;
+};
+
+#endif // BRAWCAP_INDEX_READER_HPP
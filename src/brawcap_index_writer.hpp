@@ -0,0 +1,199 @@
+/**
+ * @file brawcap_index_writer.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Index Writer (time and flow index sidecar for capture files).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_INDEX_WRITER_HPP
+#define BRAWCAP_INDEX_WRITER_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_flow.hpp"
+#include "brawcap_file_writer.hpp"
+#endif // INCLUDES
+
+// Writes an index next to a capture file: one entry per block of about blockBytes capture data, holding the byte
+// range, the time range and a bloom filter over the symmetric flow hashes of the packets inside.
+class BRAWcapIndexWriter
+{
+public:
+  static constexpr uint64_t MAGIC = 0x3158444943574242ULL; // "BBWCIDX1"
+  static constexpr uint32_t VERSION = 1;
+  static constexpr uint32_t BLOCK_BYTES_DEFAULT = 4 * 1024 * 1024;
+  static constexpr uint32_t BLOOM_BITS_DEFAULT = 8192;
+  static constexpr uint32_t BLOOM_HASHES = 3;
+
+#pragma pack(push, 1)
+  struct FileHeader
+  {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t blockBytes;
+    uint32_t bloomBits;
+    uint32_t entrySize;
+    uint64_t reserved;
+  };
+  
+  // Followed by bloomBits / 8 bytes of bloom filter.
+  struct EntryHeader
+  {
+    uint64_t beginOffset;
+    uint64_t endOffset;
+    uint64_t firstNs;
+    uint64_t lastNs;
+    uint32_t packets;
+    uint32_t reserved;
+  };
+#pragma pack(pop)
+  
+  inline static void BloomAdd(uint8_t* pBloom, const uint32_t bloomBits, const uint32_t flowHash)
+  {
+    uint32_t hash = flowHash;
+    const uint32_t step = ((flowHash >> 17) | (flowHash << 15)) | 1;
+    for(uint32_t index = 0; index < BLOOM_HASHES; ++index, hash += step)
+    {
+      const uint32_t bit = hash & (bloomBits - 1);
+      pBloom[bit >> 3] |= static_cast<uint8_t>(1 << (bit & 7));
+    }
+  }
+  
+  inline static bool BloomContains(const uint8_t* pBloom, const uint32_t bloomBits, const uint32_t flowHash)
+  {
+    uint32_t hash = flowHash;
+    const uint32_t step = ((flowHash >> 17) | (flowHash << 15)) | 1;
+    for(uint32_t index = 0; index < BLOOM_HASHES; ++index, hash += step)
+    {
+      const uint32_t bit = hash & (bloomBits - 1);
+      if(!(pBloom[bit >> 3] & (1 << (bit & 7))))
+        return false;
+    }
+    return true;
+  }
+  
+public:
+  inline BRAWcapIndexWriter(const uint32_t blockBytes = BLOCK_BYTES_DEFAULT,
+    const uint32_t bloomBits = BLOOM_BITS_DEFAULT)
+    : m_file(64 * 1024), m_blockBytes(blockBytes), m_bloomBits(bloomBits), m_entry(), m_bloom(bloomBits / 8),
+      m_entries(0), m_writeFailed(false)
+  {
+    assert(blockBytes && bloomBits >= 64 && !(bloomBits & (bloomBits - 1)));
+  }
+  
+  inline ~BRAWcapIndexWriter()
+  {
+    if(IsOpen())
+      Close();
+  }
+  
+  inline bool Open(const std::string& path)
+  {
+    if(!m_file.Open(path))
+      return false;
+    m_entry.packets = 0;
+    m_entries = 0;
+    m_writeFailed = false;
+    
+    FileHeader header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.blockBytes = m_blockBytes;
+    header.bloomBits = m_bloomBits;
+    header.entrySize = static_cast<uint32_t>(sizeof(EntryHeader) + m_bloom.size());
+    return m_file.Write(&header, sizeof(header));
+  }
+  
+  // False if any entry could not be written, the index is incomplete then.
+  inline bool Close()
+  {
+    EntryFlush();
+    const bool closed = m_file.Close();
+    return closed && !m_writeFailed;
+  }
+  
+  inline bool IsOpen() const
+  {
+    return m_file.IsOpen();
+  }
+  
+  inline uint64_t Entries() const
+  {
+    return m_entries;
+  }
+  
+  // Records a packet which was written to the capture file at fileOffset, recordSize includes the record header.
+  inline void Add(const uint64_t fileOffset, const uint32_t recordSize, const uint64_t timestampNs,
+    const uint32_t flowHash)
+  {
+    if(m_entry.packets && fileOffset >= m_entry.beginOffset + m_blockBytes)
+      EntryFlush();
+    
+    if(!m_entry.packets)
+    {
+      m_entry.beginOffset = fileOffset;
+      m_entry.firstNs = timestampNs;
+      m_entry.lastNs = timestampNs;
+    }
+    m_entry.endOffset = fileOffset + recordSize;
+    m_entry.firstNs = std::min(m_entry.firstNs, timestampNs);
+    m_entry.lastNs = std::max(m_entry.lastNs, timestampNs);
+    ++m_entry.packets;
+    BloomAdd(m_bloom.data(), m_bloomBits, flowHash);
+  }
+  
+  inline void Add(const uint64_t fileOffset, const uint32_t recordSize, const uint64_t timestampNs,
+    const char* pFrame, const uint32_t length)
+  {
+    Add(fileOffset, recordSize, timestampNs, BRAWcapFlow::Hash(pFrame, length));
+  }
+  
+private:
+  inline void EntryFlush()
+  {
+    if(!m_entry.packets)
+      return;
+    if(!m_file.Write(&m_entry, sizeof(m_entry)) || !m_file.Write(m_bloom.data(), m_bloom.size()))
+      m_writeFailed = true;
+    std::fill(m_bloom.begin(), m_bloom.end(), 0);
+    m_entry.packets = 0;
+    ++m_entries;
+  }
+  
+private:
+  BRAWcapFileWriter m_file;
+  uint32_t m_blockBytes;
+  uint32_t m_bloomBits;
+  EntryHeader m_entry;
+  std::vector<uint8_t> m_bloom;
+  uint64_t m_entries;
+  bool m_writeFailed; // sticky until the next Open()
+};
+
+#endif // BRAWCAP_INDEX_WRITER_HPP
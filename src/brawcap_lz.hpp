@@ -0,0 +1,223 @@
+/**
+ * @file brawcap_lz.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper LZ (fast LZ4 block format codec).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_LZ_HPP
+#define BRAWCAP_LZ_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+// CPP
+#include <array>
+#endif // INCLUDES
+
+// Greedy single pass compressor producing the LZ4 block format, plus a bounds checked decompressor.
+class BRAWcapLz
+{
+public:
+  inline static size_t CompressBound(const size_t length)
+  {
+    return length + length / 255 + 16;
+  }
+  
+  // Returns the compressed size, 0 if capacity is below CompressBound(length).
+  inline static size_t Compress(const char* pSource, const size_t length, char* pDestination, const size_t capacity)
+  {
+    if(capacity < CompressBound(length))
+      return 0;
+    
+    const uint8_t* const pBase = reinterpret_cast<const uint8_t*>(pSource);
+    const uint8_t* const pEnd = pBase + length;
+    const uint8_t* pIn = pBase;
+    const uint8_t* pAnchor = pBase;
+    uint8_t* pOut = reinterpret_cast<uint8_t*>(pDestination);
+    
+    if(length >= MIN_INPUT)
+    {
+      const uint8_t* const pMatchFindLimit = pEnd - MF_LIMIT;
+      const uint8_t* const pMatchLimit = pEnd - LAST_LITERALS;
+      std::array<uint32_t, 1 << HASH_LOG> table;
+      table.fill(0);
+      
+      ++pIn;
+      uint32_t misses = 0;
+      while(pIn < pMatchFindLimit)
+      {
+        const uint32_t sequence = Read32(pIn);
+        uint32_t& slot = table[Hash(sequence)];
+        const uint8_t* pRef = pBase + slot;
+        slot = static_cast<uint32_t>(pIn - pBase);
+        if(pRef >= pIn || pIn - pRef > MAX_DISTANCE || Read32(pRef) != sequence)
+        {
+          // Step faster through incompressible data.
+          pIn += 1 + (misses++ >> SKIP_TRIGGER);
+          continue;
+        }
+        misses = 0;
+        
+        while(pIn > pAnchor && pRef > pBase && pIn[-1] == pRef[-1])
+        {
+          --pIn;
+          --pRef;
+        }
+        
+        const uint8_t* pMatchEnd = pIn + MIN_MATCH;
+        const uint8_t* pRefEnd = pRef + MIN_MATCH;
+        while(pMatchEnd < pMatchLimit && *pMatchEnd == *pRefEnd)
+        {
+          ++pMatchEnd;
+          ++pRefEnd;
+        }
+        
+        pOut = SequenceWrite(pOut, pAnchor, static_cast<size_t>(pIn - pAnchor), static_cast<uint32_t>(pIn - pRef),
+          static_cast<size_t>(pMatchEnd - pIn));
+        pIn = pMatchEnd;
+        pAnchor = pIn;
+        if(pIn < pMatchFindLimit)
+          table[Hash(Read32(pIn - 2))] = static_cast<uint32_t>(pIn - 2 - pBase);
+      }
+    }
+    
+    pOut = SequenceWrite(pOut, pAnchor, static_cast<size_t>(pEnd - pAnchor), 0, 0);
+    return static_cast<size_t>(pOut - reinterpret_cast<uint8_t*>(pDestination));
+  }
+  
+  // Returns the decompressed size, 0 on malformed input or insufficient capacity.
+  inline static size_t Decompress(const char* pSource, const size_t length, char* pDestination,
+    const size_t capacity)
+  {
+    const uint8_t* pIn = reinterpret_cast<const uint8_t*>(pSource);
+    const uint8_t* const pInEnd = pIn + length;
+    uint8_t* const pOutBase = reinterpret_cast<uint8_t*>(pDestination);
+    uint8_t* pOut = pOutBase;
+    uint8_t* const pOutEnd = pOut + capacity;
+    
+    while(pIn < pInEnd)
+    {
+      const uint8_t token = *pIn++;
+      size_t literals = token >> 4;
+      if(literals == 15 && !LengthRead(pIn, pInEnd, literals))
+        return 0;
+      if(literals > static_cast<size_t>(pInEnd - pIn) || literals > static_cast<size_t>(pOutEnd - pOut))
+        return 0;
+      memcpy(pOut, pIn, literals);
+      pIn += literals;
+      pOut += literals;
+      if(pIn == pInEnd)
+        break;
+      
+      if(pInEnd - pIn < 2)
+        return 0;
+      const size_t distance = pIn[0] | (pIn[1] << 8);
+      pIn += 2;
+      if(!distance || distance > static_cast<size_t>(pOut - pOutBase))
+        return 0;
+      
+      size_t match = token & 15;
+      if(match == 15 && !LengthRead(pIn, pInEnd, match))
+        return 0;
+      match += MIN_MATCH;
+      if(match > static_cast<size_t>(pOutEnd - pOut))
+        return 0;
+      
+      const uint8_t* pRef = pOut - distance;
+      if(distance >= match)
+        memcpy(pOut, pRef, match);
+      else
+        for(size_t index = 0; index < match; ++index)
+          pOut[index] = pRef[index];
+      pOut += match;
+    }
+    return static_cast<size_t>(pOut - pOutBase);
+  }
+  
+private:
+  static constexpr int HASH_LOG = 12;
+  static constexpr int SKIP_TRIGGER = 6;
+  static constexpr size_t MIN_MATCH = 4;
+  static constexpr size_t LAST_LITERALS = 5;
+  static constexpr size_t MF_LIMIT = 12;
+  static constexpr size_t MIN_INPUT = MF_LIMIT + 1;
+  static constexpr ptrdiff_t MAX_DISTANCE = 65535;
+  
+private:
+  inline static uint32_t Read32(const uint8_t* pBytes)
+  {
+    uint32_t value;
+    memcpy(&value, pBytes, sizeof(value));
+    return value;
+  }
+  
+  inline static uint32_t Hash(const uint32_t sequence)
+  {
+    return (sequence * 2654435761U) >> (32 - HASH_LOG);
+  }
+  
+  inline static uint8_t* LengthWrite(uint8_t* pOut, size_t length)
+  {
+    for(; length >= 255; length -= 255)
+      *pOut++ = 255;
+    *pOut++ = static_cast<uint8_t>(length);
+    return pOut;
+  }
+  
+  inline static bool LengthRead(const uint8_t*& pIn, const uint8_t* pInEnd, size_t& length)
+  {
+    uint8_t value = 0;
+    do
+    {
+      if(pIn == pInEnd)
+        return false;
+      value = *pIn++;
+      length += value;
+    } while(value == 255);
+    return true;
+  }
+  
+  // match == 0 writes the final, literal only sequence.
+  inline static uint8_t* SequenceWrite(uint8_t* pOut, const uint8_t* pLiterals, const size_t literals,
+    const uint32_t distance, const size_t match)
+  {
+    uint8_t* pToken = pOut++;
+    *pToken = static_cast<uint8_t>((literals >= 15 ? 15 : literals) << 4);
+    if(literals >= 15)
+      pOut = LengthWrite(pOut, literals - 15);
+    if(literals)
+      memcpy(pOut, pLiterals, literals);
+    pOut += literals;
+    if(!match)
+      return pOut;
+    
+    *pOut++ = static_cast<uint8_t>(distance);
+    *pOut++ = static_cast<uint8_t>(distance >> 8);
+    const size_t matchCode = match - MIN_MATCH;
+    *pToken |= static_cast<uint8_t>(matchCode >= 15 ? 15 : matchCode);
+    if(matchCode >= 15)
+      pOut = LengthWrite(pOut, matchCode - 15);
+    return pOut;
+  }
+};
+
+#endif // BRAWCAP_LZ_HPP
@@ -0,0 +1,327 @@
+/**
+ * @file brawcap_multi_receive.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Multi Receive (time ordered merge of several handles).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_MULTI_RECEIVE_HPP
+#define BRAWCAP_MULTI_RECEIVE_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cassert>
+// CPP
+#include <string>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_receive.hpp"
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet_view.hpp"
+#include "brawcap_ring.hpp"
+#endif // INCLUDES
+
+class BRAWcapMultiReceive
+{
+public:
+  using PacketCallback = void(*)(const BRAWcapPacketView& packet, size_t adapterIndex, void* pUser);
+  
+  struct Stats
+  {
+    uint64_t packetsMerged;
+    uint64_t packetsLate;
+    uint64_t buffersDropped;
+  };
+  
+public:
+  inline BRAWcapMultiReceive(const std::vector<std::string>& names, const brawcap_packet_size_t maxPacketPayloadSize,
+    const brawcap_buffer_packet_count_t packetsPerBuffer, const size_t buffersPerAdapter)
+    : m_reorderWindowNs(1000000), m_callback(nullptr), m_pUser(nullptr), m_running(false), m_stopping(false),
+      m_packetsMerged(0), m_packetsLate(0), m_buffersDropped(0)
+  {
+    assert(!names.empty());
+    for(size_t index = 0; index < names.size(); ++index)
+    {
+      std::unique_ptr<Source> pSource = std::make_unique<Source>(names[index], buffersPerAdapter);
+      pSource->pParent = this;
+      pSource->index = index;
+      pSource->receive.ReceiveBufferPoolCreate(maxPacketPayloadSize, packetsPerBuffer, buffersPerAdapter);
+      for(auto& batch : pSource->batches)
+      {
+        batch.entries.reserve(packetsPerBuffer);
+        pSource->freeBatches.TryPush(&batch);
+      }
+      m_sources.push_back(std::move(pSource));
+    }
+  }
+  
+  inline ~BRAWcapMultiReceive()
+  {
+    if(m_running)
+      Stop();
+  }
+  
+  BRAWcapMultiReceive(const BRAWcapMultiReceive&) = delete;
+  BRAWcapMultiReceive& operator=(const BRAWcapMultiReceive&) = delete;
+  
+  inline size_t Count() const
+  {
+    return m_sources.size();
+  }
+  
+  inline BRAWcapReceive& Receiver(const size_t index)
+  {
+    assert(index < m_sources.size());
+    return m_sources[index]->receive;
+  }
+  
+  // May change while running, the merger picks it up with the next packet.
+  inline void ReorderWindowNanosecondsSet(const uint64_t windowNs)
+  {
+    m_reorderWindowNs.store(windowNs, std::memory_order_relaxed);
+  }
+  
+  inline uint64_t ReorderWindowNanoseconds() const
+  {
+    return m_reorderWindowNs.load(std::memory_order_relaxed);
+  }
+  
+  inline void Start(PacketCallback callback, void* pUser)
+  {
+    assert(callback && !m_running);
+    m_callback = callback;
+    m_pUser = pUser;
+    m_stopping = false;
+    m_running = true;
+    m_merger = std::thread(&BRAWcapMultiReceive::MergeLoop, this);
+    for(auto& pSource : m_sources)
+      pSource->receive.ReceivePooledStart(ReceiveBufferComplete, pSource.get());
+  }
+  
+  inline void Stop()
+  {
+    assert(m_running);
+    for(auto& pSource : m_sources)
+      pSource->receive.ReceiveStop();
+    
+    m_stopping = true;
+    m_merger.join();
+    m_running = false;
+    m_callback = nullptr;
+    m_pUser = nullptr;
+  }
+  
+  inline void Statistics(Stats& stats) const
+  {
+    stats.packetsMerged = m_packetsMerged.load(std::memory_order_relaxed);
+    stats.packetsLate = m_packetsLate.load(std::memory_order_relaxed);
+    stats.buffersDropped = m_buffersDropped.load(std::memory_order_relaxed);
+  }
+  
+private:
+  struct Entry
+  {
+    uint64_t timestampNs;
+    brawcap_packet_t* pPacket;
+    
+    inline bool operator< (const Entry& b) const
+    {
+      return timestampNs < b.timestampNs;
+    }
+  };
+  
+  struct Batch
+  {
+    BRAWcapBuffer* pBuffer;
+    std::vector<Entry> entries;
+    size_t position;
+  };
+  
+  struct Source
+  {
+    inline Source(const std::string& name, const size_t numBatches)
+      : receive(name), batches(numBatches), freeBatches(numBatches), readyBatches(numBatches), pCurrent(nullptr),
+        pParent(nullptr), index(0)
+    { }
+    
+    BRAWcapReceive receive;
+    std::vector<Batch> batches;
+    BRAWcapRing<Batch*> freeBatches;
+    BRAWcapRing<Batch*> readyBatches;
+    Batch* pCurrent;
+    BRAWcapMultiReceive* pParent;
+    size_t index;
+  };
+  
+  struct HeapEntry
+  {
+    uint64_t timestampNs;
+    size_t source;
+    
+    inline bool operator> (const HeapEntry& b) const
+    {
+      return timestampNs > b.timestampNs;
+    }
+  };
+  
+private:
+  // Runs on the receive thread of each handle: sort the buffer once, then publish it to the merger.
+  inline static void ReceiveBufferComplete(BRAWcapBuffer& buffer, brawcap_status_t status, void* pUser)
+  {
+    Source* pSource = reinterpret_cast<Source*>(pUser);
+    Batch* pBatch = nullptr;
+    if(!BRAWCAP_SUCCESS(status) || !pSource->freeBatches.TryPop(pBatch))
+    {
+      if(BRAWCAP_SUCCESS(status))
+        pSource->pParent->m_buffersDropped.fetch_add(1, std::memory_order_relaxed);
+      pSource->receive.ReceiveBufferRelease(buffer);
+      return;
+    }
+    
+    pBatch->pBuffer = &buffer;
+    pBatch->position = 0;
+    pBatch->entries.clear();
+    buffer.ForEach([pBatch](const BRAWcapPacketView& packet)
+    {
+      uint64_t seconds = 0;
+      uint32_t nanoseconds = 0;
+      packet.TimestampNs(seconds, nanoseconds);
+      pBatch->entries.push_back({ seconds * 1000000000ULL + nanoseconds, packet.Native() });
+    });
+    std::stable_sort(pBatch->entries.begin(), pBatch->entries.end());
+    
+    if(pBatch->entries.empty())
+    {
+      pSource->receive.ReceiveBufferRelease(buffer);
+      pSource->freeBatches.TryPush(pBatch);
+      return;
+    }
+    
+    const bool pushed = pSource->readyBatches.TryPush(pBatch);
+    assert(pushed);
+  }
+  
+  inline void MergeLoop()
+  {
+    std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> heap;
+    uint64_t newestNs = 0;
+    uint64_t lastEmittedNs = 0;
+    uint32_t idleRounds = 0;
+    
+    for(;;)
+    {
+      const bool stopping = m_stopping.load(std::memory_order_acquire);
+      
+      for(auto& pSource : m_sources)
+      {
+        if(pSource->pCurrent || !pSource->readyBatches.TryPop(pSource->pCurrent))
+          continue;
+        
+        newestNs = std::max(newestNs, pSource->pCurrent->entries.back().timestampNs);
+        heap.push({ pSource->pCurrent->entries.front().timestampNs, pSource->index });
+      }
+      
+      bool emitted = false;
+      while(!heap.empty())
+      {
+        const HeapEntry top = heap.top();
+        
+        // Emit if every adapter has data pending (exact merge) or the packet has aged out of the reorder window.
+        const bool complete = heap.size() == m_sources.size();
+        const bool aged = top.timestampNs + m_reorderWindowNs.load(std::memory_order_relaxed) <= newestNs;
+        if(!complete && !aged && !stopping)
+          break;
+        
+        heap.pop();
+        Source& source = *m_sources[top.source];
+        Batch& batch = *source.pCurrent;
+        const Entry& entry = batch.entries[batch.position];
+        
+        if(entry.timestampNs < lastEmittedNs)
+          m_packetsLate.fetch_add(1, std::memory_order_relaxed);
+        else
+          lastEmittedNs = entry.timestampNs;
+        m_callback(BRAWcapPacketView(entry.pPacket), source.index, m_pUser);
+        m_packetsMerged.fetch_add(1, std::memory_order_relaxed);
+        emitted = true;
+        
+        if(++batch.position < batch.entries.size())
+        {
+          heap.push({ batch.entries[batch.position].timestampNs, source.index });
+          continue;
+        }
+        
+        // Batch exhausted: hand the buffer back to its pool and continue with the next one of this adapter.
+        source.receive.ReceiveBufferRelease(*batch.pBuffer);
+        source.freeBatches.TryPush(&batch);
+        source.pCurrent = nullptr;
+        if(source.readyBatches.TryPop(source.pCurrent))
+        {
+          newestNs = std::max(newestNs, source.pCurrent->entries.back().timestampNs);
+          heap.push({ source.pCurrent->entries.front().timestampNs, source.index });
+        }
+      }
+      
+      if(emitted)
+      {
+        idleRounds = 0;
+        continue;
+      }
+      
+      if(stopping)
+      {
+        bool pending = false;
+        for(auto& pSource : m_sources)
+          pending |= !pSource->readyBatches.Empty();
+        if(!pending)
+          break;
+        continue;
+      }
+      
+      if(++idleRounds < 64)
+        std::this_thread::yield();
+      else
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  
+private:
+  std::vector<std::unique_ptr<Source>> m_sources;
+  std::atomic<uint64_t> m_reorderWindowNs;
+  PacketCallback m_callback;
+  void* m_pUser;
+  std::thread m_merger;
+  std::atomic<bool> m_running;
+  std::atomic<bool> m_stopping;
+  std::atomic<uint64_t> m_packetsMerged;
+  std::atomic<uint64_t> m_packetsLate;
+  std::atomic<uint64_t> m_buffersDropped;
+};
+
+#endif // BRAWCAP_MULTI_RECEIVE_HPP
@@ -0,0 +1,355 @@
+/**
+ * @file brawcap_paced_sender.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Paced Sender (token bucket rate limited transmission).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_PACED_SENDER_HPP
+#define BRAWCAP_PACED_SENDER_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cassert>
+#include <cmath>
+// CPP
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet_view.hpp"
+#include "brawcap_transmit.hpp"
+#include "brawcap_clock.hpp"
+#endif // INCLUDES
+
+// Sends at a fixed bit or packet rate through BRAWcapTransmit. Packets are requested from a fill callback in
+// batches sized to span about batchNs at the configured rate. A token bucket decides when a batch may go and the
+// packets inside are timestamped at the rate, so the driver spaces them (synchronized send). The adapter transmit
+// speed is an additional ceiling. Uses the transmit buffer pool, the transmit handle must not have one yet. The
+// achieved rate is measured from the transmit timestamps the driver writes into completed packets.
+class BRAWcapPacedSender
+{
+public:
+  // Appends up to maxPackets packets to the empty buffer, returns how many were added. 0 ends the transmission.
+  typedef size_t(*FillCallback)(BRAWcapBuffer& buffer, size_t maxPackets, void* pUser);
+  
+  enum class RateUnit
+  {
+    BITS_PER_SECOND,
+    PACKETS_PER_SECOND
+  };
+  
+  // Preamble, start of frame delimiter and inter frame gap, accounted for with lineRate.
+  static constexpr uint32_t WIRE_OVERHEAD_BYTES = 20;
+  static constexpr uint32_t FCS_BYTES = 4;
+  static constexpr uint32_t FRAME_SIZE_MIN = 60;
+  
+  struct Config
+  {
+    RateUnit unit = RateUnit::BITS_PER_SECOND;
+    double rate = 0; // in unit
+    double burst = 0; // bucket depth in unit (bits or packets), 0: one batch
+    bool lineRate = true; // bit rates include FCS, preamble and inter frame gap like the adapter speed does
+    uint64_t batchNs = 1000000; // time a batch spans at the configured rate
+    brawcap_packet_size_t maxPacketPayloadSize = BRAWCAP_PACKET_SIZE_MAX;
+    brawcap_buffer_packet_count_t packetsPerBuffer = 4096;
+    size_t bufferCount = 8;
+  };
+  
+  struct Stats
+  {
+    uint64_t packetsSent; // handed to the driver
+    uint64_t packetsCompleted; // reported transmitted by the driver
+    uint64_t bytesSent;
+    uint64_t batchesSent;
+    uint64_t poolWaits; // all buffers in flight, the driver is behind the configured rate
+    uint64_t sendFailures;
+    double ceilingBitsPerSecond; // adapter transmit speed, 0 if unknown
+    double achievedBitsPerSecond; // from the driver transmit timestamps, in the same accounting as the rate
+    double achievedPacketsPerSecond;
+    double rateErrorPercent; // achieved against configured rate
+    uint64_t jitterMeanNs; // batch send time against its token bucket deadline
+    uint64_t jitterMaxNs;
+  };
+  
+public:
+  inline BRAWcapPacedSender(BRAWcapTransmit& transmit, const Config& config, BRAWcapClock* pClock = nullptr)
+    : m_transmit(transmit), m_config(config), m_pClock(pClock), m_callback(nullptr), m_pUser(nullptr),
+      m_ceilingBitsPerSecond(0), m_running(false), m_stopping(false), m_finished(false), m_packetsSent(0),
+      m_bytesSent(0), m_batchesSent(0), m_poolWaits(0), m_sendFailures(0), m_jitterSumNs(0), m_jitterMaxNs(0),
+      m_completedPackets(0), m_completedSpanBits(0), m_lastCompletedBits(0), m_firstCompletedNs(0),
+      m_lastCompletedNs(0)
+  {
+    assert(m_config.rate > 0 && m_config.batchNs && m_config.packetsPerBuffer && m_config.bufferCount >= 2);
+    if(!m_pClock)
+    {
+      m_pOwnClock = std::make_unique<BRAWcapSteadyClock>();
+      m_pClock = m_pOwnClock.get();
+    }
+  }
+  
+  inline ~BRAWcapPacedSender()
+  {
+    if(m_running)
+      Stop();
+  }
+  
+  BRAWcapPacedSender(const BRAWcapPacedSender&) = delete;
+  BRAWcapPacedSender& operator=(const BRAWcapPacedSender&) = delete;
+  
+  inline void Start(FillCallback callback, void* pUser)
+  {
+    assert(callback && !m_running);
+    m_callback = callback;
+    m_pUser = pUser;
+    const brawcap_adapter_speed_t speed = m_transmit.AdapterTxSpeed();
+    m_ceilingBitsPerSecond = speed != BRAWCAP_ADAPTER_SPEED_UNKNOWN ? speed * 1e6 : 0;
+    
+    m_transmit.TransmitBufferPoolCreate(m_config.maxPacketPayloadSize, m_config.packetsPerBuffer,
+      m_config.bufferCount);
+    {
+      std::lock_guard<std::mutex> localLock(m_completionLock);
+      m_completedPackets = 0;
+      m_completedSpanBits = 0;
+      m_lastCompletedBits = 0;
+      m_firstCompletedNs = 0;
+      m_lastCompletedNs = 0;
+    }
+    const bool started = m_transmit.TransmitStart(BufferComplete, this);
+    assert(started);
+    m_stopping = false;
+    m_finished = false;
+    m_running = true;
+    m_sender = std::thread(&BRAWcapPacedSender::SendLoop, this);
+  }
+  
+  // Waits until the batches handed to the driver have completed.
+  inline void Stop()
+  {
+    assert(m_running);
+    m_stopping = true;
+    m_sender.join();
+    while(m_transmit.TransmitBuffersPending())
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    m_transmit.TransmitStop();
+    m_transmit.TransmitBufferPoolDestroy();
+    m_running = false;
+  }
+  
+  // The fill callback ended the transmission.
+  inline bool Finished() const
+  {
+    return m_finished;
+  }
+  
+  inline void Statistics(Stats& stats) const
+  {
+    stats.packetsSent = m_packetsSent.load(std::memory_order_relaxed);
+    stats.bytesSent = m_bytesSent.load(std::memory_order_relaxed);
+    stats.batchesSent = m_batchesSent.load(std::memory_order_relaxed);
+    stats.poolWaits = m_poolWaits.load(std::memory_order_relaxed);
+    stats.sendFailures = m_sendFailures.load(std::memory_order_relaxed);
+    stats.ceilingBitsPerSecond = m_ceilingBitsPerSecond;
+    
+    // Measured between the transmit timestamps of the first and the last completed packet, so the span covers all
+    // but the last packet.
+    double seconds = 0;
+    double spanBits = 0;
+    {
+      std::lock_guard<std::mutex> localLock(m_completionLock);
+      stats.packetsCompleted = m_completedPackets;
+      spanBits = m_completedSpanBits;
+      if(m_lastCompletedNs > m_firstCompletedNs)
+        seconds = (m_lastCompletedNs - m_firstCompletedNs) / 1e9;
+    }
+    stats.achievedBitsPerSecond = seconds > 0 ? spanBits / seconds : 0;
+    stats.achievedPacketsPerSecond = seconds > 0 ? (stats.packetsCompleted - 1) / seconds : 0;
+    const double achieved = m_config.unit == RateUnit::BITS_PER_SECOND ? stats.achievedBitsPerSecond :
+      stats.achievedPacketsPerSecond;
+    stats.rateErrorPercent = seconds > 0 ? (achieved - m_config.rate) / m_config.rate * 100 : 0;
+    stats.jitterMeanNs = stats.batchesSent ? m_jitterSumNs.load(std::memory_order_relaxed) / stats.batchesSent : 0;
+    stats.jitterMaxNs = m_jitterMaxNs.load(std::memory_order_relaxed);
+  }
+  
+  // Bits a packet occupies on the wire, including padding, FCS, preamble and inter frame gap.
+  inline static double LineBits(const brawcap_packet_size_t payloadLength)
+  {
+    return (std::max<uint32_t>(payloadLength, FRAME_SIZE_MIN) + FCS_BYTES + WIRE_OVERHEAD_BYTES) * 8.0;
+  }
+  
+  // Bits a packet occupies in the configured accounting.
+  inline double PacketBits(const brawcap_packet_size_t payloadLength) const
+  {
+    return m_config.lineRate ? LineBits(payloadLength) : payloadLength * 8.0;
+  }
+  
+private:
+  // Seconds a packet takes from the bucket and from the adapter ceiling, the slower one wins.
+  inline double PacketSeconds(const brawcap_packet_size_t payloadLength) const
+  {
+    const double bits = PacketBits(payloadLength);
+    const double seconds = m_config.unit == RateUnit::BITS_PER_SECOND ? bits / m_config.rate : 1.0 / m_config.rate;
+    if(!m_ceilingBitsPerSecond)
+      return seconds;
+    return std::max(seconds, LineBits(payloadLength) / m_ceilingBitsPerSecond);
+  }
+  
+  // Completed buffers carry the transmit timestamps the driver wrote over the scheduled ones.
+  inline static void BufferComplete(BRAWcapBuffer& buffer, const brawcap_status_t status, void* pUser)
+  {
+    if(!BRAWCAP_SUCCESS(status))
+      return;
+    BRAWcapPacedSender* pSender = reinterpret_cast<BRAWcapPacedSender*>(pUser);
+    std::lock_guard<std::mutex> localLock(pSender->m_completionLock);
+    buffer.ForEach([pSender](const BRAWcapPacketView& packet)
+    {
+      uint64_t seconds = 0;
+      uint32_t nanoseconds = 0;
+      packet.TimestampNs(seconds, nanoseconds);
+      const uint64_t timestampNs = seconds * 1000000000 + nanoseconds;
+      if(!pSender->m_completedPackets)
+        pSender->m_firstCompletedNs = timestampNs;
+      else
+        pSender->m_completedSpanBits += pSender->m_lastCompletedBits;
+      pSender->m_lastCompletedNs = timestampNs;
+      pSender->m_lastCompletedBits = pSender->PacketBits(packet.PayloadLength());
+      ++pSender->m_completedPackets;
+    });
+  }
+  
+  inline void SendLoop()
+  {
+    // Bucket in seconds of transmission: a batch may go once the bucket is not in debt, it then takes the
+    // duration of the batch. The depth bounds how far sending may run ahead after an idle phase.
+    const double batchSeconds = m_config.batchNs / 1e9;
+    const double depthSeconds = std::max(batchSeconds, m_config.burst / m_config.rate);
+    double bucketSeconds = 0;
+    double packetSecondsAverage = PacketSeconds(1500);
+    uint64_t lastFillNs = m_pClock->NowNs();
+    
+    while(!m_stopping)
+    {
+      BRAWcapBuffer* pBuffer = m_transmit.TransmitBufferAcquire();
+      if(!pBuffer)
+      {
+        m_poolWaits.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        continue;
+      }
+      
+      const size_t batch = static_cast<size_t>(std::min<double>(m_config.packetsPerBuffer,
+        std::max(1.0, std::floor(batchSeconds / packetSecondsAverage))));
+      if(!m_callback(*pBuffer, batch, m_pUser))
+      {
+        m_transmit.TransmitBufferRelease(pBuffer);
+        m_finished = true;
+        break;
+      }
+      
+      // Refill, then wait until the bucket is out of debt.
+      uint64_t nowNs = m_pClock->NowNs();
+      bucketSeconds = std::min(depthSeconds, bucketSeconds + (nowNs - lastFillNs) / 1e9);
+      lastFillNs = nowNs;
+      if(bucketSeconds < 0)
+      {
+        const uint64_t deadlineNs = nowNs + static_cast<uint64_t>(-bucketSeconds * 1e9);
+        m_pClock->SleepUntilNs(deadlineNs);
+        nowNs = m_pClock->NowNs();
+        const uint64_t jitterNs = nowNs > deadlineNs ? nowNs - deadlineNs : 0;
+        m_jitterSumNs.fetch_add(jitterNs, std::memory_order_relaxed);
+        if(jitterNs > m_jitterMaxNs.load(std::memory_order_relaxed))
+          m_jitterMaxNs.store(jitterNs, std::memory_order_relaxed);
+        // Refill from the deadline, the oversleep is credited to the next batch instead of being lost.
+        bucketSeconds = 0;
+        lastFillNs = deadlineNs;
+      }
+      
+      // Packet timestamps only carry the gaps for the driver, the batch starts at its send time.
+      double offsetSeconds = 0;
+      uint64_t bytes = 0;
+      const brawcap_buffer_packet_count_t count = pBuffer->ForEach([&](const BRAWcapPacketView& packet)
+      {
+        const uint64_t timestampNs = nowNs + static_cast<uint64_t>(offsetSeconds * 1e9);
+        brawcap_timestamp_t* pTimestamp = nullptr;
+        brawcap_status_t status = brawcap_packet_timestamp_get(packet.Native(), &pTimestamp);
+        assert(!BRAWCAP_ERROR(status) && pTimestamp);
+        brawcap_timestamp_value_ns_set(pTimestamp, timestampNs / 1000000000, timestampNs % 1000000000);
+        offsetSeconds += PacketSeconds(packet.PayloadLength());
+        bytes += packet.PayloadLength();
+      });
+      
+      if(!count)
+      {
+        m_transmit.TransmitBufferRelease(pBuffer);
+        continue;
+      }
+      
+      bucketSeconds -= offsetSeconds;
+      packetSecondsAverage = packetSecondsAverage * 0.75 + offsetSeconds / count * 0.25;
+      // A rejected pooled buffer is returned to the pool by BRAWcapTransmit.
+      if(!m_transmit.TransmitBufferSend(*pBuffer, true))
+      {
+        m_sendFailures.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      
+      m_packetsSent.fetch_add(count, std::memory_order_relaxed);
+      m_bytesSent.fetch_add(bytes, std::memory_order_relaxed);
+      m_batchesSent.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  
+private:
+  BRAWcapTransmit& m_transmit;
+  Config m_config;
+  BRAWcapClock* m_pClock;
+  std::unique_ptr<BRAWcapClock> m_pOwnClock;
+  FillCallback m_callback;
+  void* m_pUser;
+  double m_ceilingBitsPerSecond;
+  std::thread m_sender;
+  std::atomic<bool> m_running;
+  std::atomic<bool> m_stopping;
+  std::atomic<bool> m_finished;
+  
+  std::atomic<uint64_t> m_packetsSent;
+  std::atomic<uint64_t> m_bytesSent;
+  std::atomic<uint64_t> m_batchesSent;
+  std::atomic<uint64_t> m_poolWaits;
+  std::atomic<uint64_t> m_sendFailures;
+  std::atomic<uint64_t> m_jitterSumNs;
+  std::atomic<uint64_t> m_jitterMaxNs;
+  
+  // Driver side, updated on completion.
+  mutable std::mutex m_completionLock;
+  uint64_t m_completedPackets;
+  double m_completedSpanBits;
+  double m_lastCompletedBits;
+  uint64_t m_firstCompletedNs;
+  uint64_t m_lastCompletedNs;
+};
+
+#endif // BRAWCAP_PACED_SENDER_HPP
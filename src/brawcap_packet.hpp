@@ -34,6 +34,7 @@
 // bRAWcap
 #include "libbrawcap.h"
 #include "brawcap_timestamp.hpp"
+#include "brawcap_packet_view.hpp"
 #endif // INCLUDES
 
 class BRAWcapPacket : public BRAWcapTimestamp
@@ -184,6 +185,11 @@ public:
     BRAWcapTimestamp::MillisecondsSet(seconds, milliseconds);
   }
   
+  inline BRAWcapPacketView View() const
+  {
+    return BRAWcapPacketView(ResolvePacket());
+  }
+  
 private:
   inline BRAWcapPacket(std::shared_ptr<brawcap_buffer_t> pBuffer, brawcap_packet_t* pBufferedPacket)
     : m_created(false)
@@ -0,0 +1,176 @@
+/**
+ * @file brawcap_packet_view.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Packet View (non-owning).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_PACKET_VIEW_HPP
+#define BRAWCAP_PACKET_VIEW_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cassert>
+// CPP
+#include <type_traits>
+
+// bRAWcap
+#include "libbrawcap.h"
+#endif // INCLUDES
+
+class BRAWcapPacketView
+{
+public:
+  inline BRAWcapPacketView()
+    : m_pPacket(nullptr), m_pPayload(nullptr), m_length(0)
+  { }
+  
+  inline explicit BRAWcapPacketView(brawcap_packet_t* const pPacket)
+    : m_pPacket(pPacket), m_pPayload(nullptr), m_length(0)
+  {
+    assert(pPacket);
+    brawcap_status_t status = brawcap_packet_payload_get(m_pPacket, &m_pPayload, &m_length);
+    assert(!BRAWCAP_ERROR(status));
+  }
+  
+  inline bool Valid() const
+  {
+    return m_pPacket != nullptr;
+  }
+  
+  inline brawcap_status_t Status() const
+  {
+    brawcap_status_t packetStatus = BRAWCAP_STATUS_ERROR_FAILED;
+    brawcap_status_t status = brawcap_packet_status_get(m_pPacket, &packetStatus);
+    assert(!BRAWCAP_ERROR(status));
+    return packetStatus;
+  }
+  
+  inline brawcap_packet_size_t MaxPayloadSize() const
+  {
+    brawcap_packet_size_t maxPayloadSize = 0;
+    brawcap_status_t status = brawcap_packet_payload_max_size_get(m_pPacket, &maxPayloadSize);
+    assert(!BRAWCAP_ERROR(status));
+    return maxPayloadSize;
+  }
+  
+  inline const char* Payload() const
+  {
+    return m_pPayload;
+  }
+  
+  inline brawcap_packet_size_t PayloadLength() const
+  {
+    return m_length;
+  }
+  
+  inline void PayloadRef(const char*& payload, brawcap_packet_size_t& length) const
+  {
+    payload = m_pPayload;
+    length = m_length;
+  }
+  
+  inline brawcap_packet_size_t LengthOnWire() const
+  {
+    brawcap_packet_size_t lengthOnWire = 0;
+    brawcap_status_t status = brawcap_packet_length_on_wire_get(m_pPacket, &lengthOnWire);
+    assert(!BRAWCAP_ERROR(status));
+    return lengthOnWire;
+  }
+  
+  inline void TimestampNs(uint64_t& seconds, uint32_t& nanoseconds) const
+  {
+    UINT64 tsSeconds = 0;
+    UINT32 tsNanoseconds = 0;
+    brawcap_status_t status = brawcap_timestamp_value_ns_get(Timestamp(), &tsSeconds, &tsNanoseconds);
+    assert(!BRAWCAP_ERROR(status));
+    seconds = tsSeconds;
+    nanoseconds = tsNanoseconds;
+  }
+  
+  inline void TimestampUs(uint64_t& seconds, uint32_t& microseconds) const
+  {
+    UINT64 tsSeconds = 0;
+    UINT32 tsMicroseconds = 0;
+    brawcap_status_t status = brawcap_timestamp_value_us_get(Timestamp(), &tsSeconds, &tsMicroseconds);
+    assert(!BRAWCAP_ERROR(status));
+    seconds = tsSeconds;
+    microseconds = tsMicroseconds;
+  }
+  
+  inline void TimestampMs(uint64_t& seconds, uint32_t& milliseconds) const
+  {
+    UINT64 tsSeconds = 0;
+    UINT32 tsMilliseconds = 0;
+    brawcap_status_t status = brawcap_timestamp_value_ms_get(Timestamp(), &tsSeconds, &tsMilliseconds);
+    assert(!BRAWCAP_ERROR(status));
+    seconds = tsSeconds;
+    milliseconds = tsMilliseconds;
+  }
+  
+  inline brawcap_timestamp_mode_t TimestampMode() const
+  {
+    brawcap_timestamp_mode_t mode = BRAWCAP_TIMESTAMP_MODE_NO_TIMESTAMP;
+    brawcap_status_t status = brawcap_timestamp_mode_get(Timestamp(), &mode);
+    assert(!BRAWCAP_ERROR(status));
+    return mode;
+  }
+  
+  inline brawcap_timestamp_resolution_ns_t TimestampResolutionNs() const
+  {
+    brawcap_timestamp_resolution_ns_t resolution = 0;
+    brawcap_status_t status = brawcap_timestamp_resolution_ns_get(Timestamp(), &resolution);
+    assert(!BRAWCAP_ERROR(status));
+    return resolution;
+  }
+  
+  inline brawcap_packet_t* Native() const
+  {
+    return m_pPacket;
+  }
+  
+  inline bool operator== (const BRAWcapPacketView& b) const
+  {
+    return m_pPacket == b.m_pPacket;
+  }
+  
+  inline bool operator!= (const BRAWcapPacketView& b) const
+  {
+    return m_pPacket != b.m_pPacket;
+  }
+  
+private:
+  inline brawcap_timestamp_t* Timestamp() const
+  {
+    brawcap_timestamp_t* pTimestamp = nullptr;
+    brawcap_status_t status = brawcap_packet_timestamp_get(m_pPacket, &pTimestamp);
+    assert(!BRAWCAP_ERROR(status) && pTimestamp);
+    return pTimestamp;
+  }
+  
+private:
+  brawcap_packet_t* m_pPacket;
+  const char* m_pPayload;
+  brawcap_packet_size_t m_length;
+};
+
+static_assert(std::is_trivially_copyable<BRAWcapPacketView>::value, "BRAWcapPacketView must stay trivially copyable.");
+
+#endif // BRAWCAP_PACKET_VIEW_HPP
@@ -0,0 +1,213 @@
+/**
+ * @file brawcap_pcap_writer.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper PCAP Writer (nanosecond pcap capture files).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_PCAP_WRITER_HPP
+#define BRAWCAP_PCAP_WRITER_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <string>
+#include <algorithm>
+#include <mutex>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet_view.hpp"
+#include "brawcap_file_packet.hpp"
+#include "brawcap_file_writer.hpp"
+#include "brawcap_index_writer.hpp"
+#endif // INCLUDES
+
+// Writes nanosecond pcap files from live and file packets, optionally feeding a BRAWcapIndexWriter. Writes are
+// serialized, so one writer can be the sink of several receive callbacks.
+class BRAWcapPcapWriter
+{
+public:
+  static constexpr uint32_t MAGIC_NANOSECONDS = 0xA1B23C4D;
+  static constexpr uint32_t LINKTYPE_ETHERNET = 1;
+  
+  struct Stats
+  {
+    uint64_t packetsWritten;
+    uint64_t packetsFailed;
+    uint64_t bytesWritten;
+    uint64_t writes;
+  };
+  
+public:
+  inline BRAWcapPcapWriter(const size_t stagingSize = BRAWcapFileWriter::STAGING_SIZE_DEFAULT)
+    : m_file(stagingSize), m_pIndex(nullptr), m_snapLength(BRAWCAP_PACKET_SIZE_MAX), m_packetsWritten(0),
+      m_packetsFailed(0)
+  { }
+  
+  inline ~BRAWcapPcapWriter()
+  {
+    if(IsOpen())
+      Close();
+  }
+  
+  inline bool Open(const std::string& path, const uint32_t snapLength = BRAWCAP_PACKET_SIZE_MAX,
+    const uint32_t linkType = LINKTYPE_ETHERNET)
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    if(!m_file.Open(path))
+      return false;
+    m_snapLength = snapLength;
+    m_packetsWritten = 0;
+    m_packetsFailed = 0;
+    
+    FileHeader header = {};
+    header.magic = MAGIC_NANOSECONDS;
+    header.versionMajor = 2;
+    header.versionMinor = 4;
+    header.snapLength = snapLength;
+    header.linkType = linkType;
+    return m_file.Write(&header, sizeof(header));
+  }
+  
+  inline bool Close()
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    return m_file.Close();
+  }
+  
+  inline bool IsOpen() const
+  {
+    return m_file.IsOpen();
+  }
+  
+  // Feeds every written packet into the index, which must be opened/closed by the caller. nullptr detaches.
+  inline void IndexAttach(BRAWcapIndexWriter* pIndex)
+  {
+    m_pIndex = pIndex;
+  }
+  
+  inline bool Flush()
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    return m_file.Flush();
+  }
+  
+  inline bool Write(const BRAWcapPacketView& packet)
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    return RecordWrite(packet);
+  }
+  
+  inline bool Write(const BRAWcapFilePacket& packet)
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    return RecordWrite(packet);
+  }
+  
+  // Appends all packets of the buffer, returns the number of packets written. Safe to call from the receive callbacks
+  // of several handles in parallel.
+  inline size_t Write(BRAWcapBuffer& buffer)
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    size_t written = 0;
+    buffer.ForEach([this, &written](const BRAWcapPacketView& packet)
+    {
+      written += RecordWrite(packet);
+    });
+    return written;
+  }
+  
+  inline void Statistics(Stats& stats) const
+  {
+    stats.packetsWritten = m_packetsWritten;
+    stats.packetsFailed = m_packetsFailed;
+    stats.bytesWritten = m_file.Size();
+    stats.writes = m_file.Writes();
+  }
+  
+public:
+#pragma pack(push, 1)
+  struct FileHeader
+  {
+    uint32_t magic;
+    uint16_t versionMajor;
+    uint16_t versionMinor;
+    int32_t thisZone;
+    uint32_t sigFigs;
+    uint32_t snapLength;
+    uint32_t linkType;
+  };
+  
+  struct RecordHeader
+  {
+    uint32_t seconds;
+    uint32_t nanoseconds;
+    uint32_t includedLength;
+    uint32_t originalLength;
+  };
+#pragma pack(pop)
+  
+private:
+  template<typename Packet>
+  inline bool RecordWrite(const Packet& packet)
+  {
+    // Truncated captures keep their on wire length in the record header.
+    const uint32_t length = std::min<uint32_t>(packet.PayloadLength(), m_snapLength);
+    char* pRecord = m_file.Reserve(sizeof(RecordHeader) + length);
+    if(!pRecord)
+    {
+      ++m_packetsFailed;
+      return false;
+    }
+    
+    uint64_t seconds = 0;
+    uint32_t nanoseconds = 0;
+    packet.TimestampNs(seconds, nanoseconds);
+    
+    RecordHeader header;
+    header.seconds = static_cast<uint32_t>(seconds);
+    header.nanoseconds = nanoseconds;
+    header.includedLength = length;
+    header.originalLength = std::max<uint32_t>(packet.LengthOnWire(), length);
+    memcpy(pRecord, &header, sizeof(header));
+    memcpy(pRecord + sizeof(header), packet.Payload(), length);
+    const uint64_t offset = m_file.Size();
+    m_file.Commit(sizeof(header) + length);
+    ++m_packetsWritten;
+    
+    if(m_pIndex)
+      m_pIndex->Add(offset, sizeof(header) + length, seconds * 1000000000ULL + nanoseconds, packet.Payload(), length);
+    return true;
+  }
+  
+private:
+  BRAWcapFileWriter m_file;
+  BRAWcapIndexWriter* m_pIndex;
+  uint32_t m_snapLength;
+  uint64_t m_packetsWritten;
+  uint64_t m_packetsFailed;
+  std::mutex m_lock;
+};
+
+#endif // BRAWCAP_PCAP_WRITER_HPP
@@ -0,0 +1,333 @@
+/**
+ * @file brawcap_pcapng_writer.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper PCAPNG Writer (multi interface capture files).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_PCAPNG_WRITER_HPP
+#define BRAWCAP_PCAPNG_WRITER_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <string>
+#include <vector>
+#include <mutex>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_adapter.hpp"
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet_view.hpp"
+#include "brawcap_file_writer.hpp"
+#include "brawcap_index_writer.hpp"
+#endif // INCLUDES
+
+class BRAWcapPcapngWriter
+{
+public:
+  static constexpr uint16_t LINKTYPE_ETHERNET = 1;
+  
+  struct Stats
+  {
+    uint64_t packetsWritten;
+    uint64_t packetsFailed;
+    uint64_t bytesWritten;
+    uint64_t writes;
+  };
+  
+public:
+  inline BRAWcapPcapngWriter(const size_t stagingSize = BRAWcapFileWriter::STAGING_SIZE_DEFAULT)
+    : m_file(stagingSize), m_pIndex(nullptr), m_interfacesWritten(0), m_packetsWritten(0), m_packetsFailed(0)
+  { }
+  
+  inline ~BRAWcapPcapngWriter()
+  {
+    if(IsOpen())
+      Close();
+  }
+  
+  inline bool Open(const std::string& path)
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    if(!m_file.Open(path))
+      return false;
+    m_interfacesWritten = 0;
+    for(auto& entry : m_interfaces)
+      entry.id = INTERFACE_ID_NONE;
+    m_packetsWritten = 0;
+    m_packetsFailed = 0;
+    return SectionHeaderWrite();
+  }
+  
+  inline bool Close()
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    return m_file.Close();
+  }
+  
+  inline bool IsOpen() const
+  {
+    return m_file.IsOpen();
+  }
+  
+  // Feeds every written packet into the index, which must be opened/closed by the caller. nullptr detaches.
+  inline void IndexAttach(BRAWcapIndexWriter* pIndex)
+  {
+    m_pIndex = pIndex;
+  }
+  
+  inline bool Flush()
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    return m_file.Flush();
+  }
+  
+  // Registers an adapter/handle as entry, returns the index to pass to Write().
+  // The interface description block is emitted with the first packet, so if_tsresol reflects the timestamp mode
+  // which is active when capturing.
+  inline size_t InterfaceAdd(const BRAWcapAdapter& adapter, const uint32_t snapLength = BRAWCAP_PACKET_SIZE_MAX)
+  {
+    Interface entry = {};
+    entry.name = adapter.AdapterName();
+    entry.description = adapter.AdapterDesc();
+    adapter.AdapterMac(entry.mac);
+    entry.speedBitsPerSecond = static_cast<uint64_t>(adapter.AdapterRxSpeed()) * 1000000ULL;
+    entry.snapLength = snapLength;
+    entry.id = INTERFACE_ID_NONE;
+    
+    std::lock_guard<std::mutex> localLock(m_lock);
+    m_interfaces.push_back(entry);
+    return m_interfaces.size() - 1;
+  }
+  
+  inline size_t InterfaceCount() const
+  {
+    return m_interfaces.size();
+  }
+  
+  // Appends all packets of the buffer, returns the number of packets written. Safe to call from the receive callbacks
+  // of several handles in parallel.
+  inline size_t Write(const size_t interfaceIndex, BRAWcapBuffer& buffer)
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    size_t written = 0;
+    buffer.ForEach([this, interfaceIndex, &written](const BRAWcapPacketView& packet)
+    {
+      written += PacketWrite(interfaceIndex, packet);
+    });
+    return written;
+  }
+  
+  inline bool Write(const size_t interfaceIndex, const BRAWcapPacketView& packet)
+  {
+    std::lock_guard<std::mutex> localLock(m_lock);
+    return PacketWrite(interfaceIndex, packet);
+  }
+  
+  inline void Statistics(Stats& stats) const
+  {
+    stats.packetsWritten = m_packetsWritten;
+    stats.packetsFailed = m_packetsFailed;
+    stats.bytesWritten = m_file.Size();
+    stats.writes = m_file.Writes();
+  }
+  
+private:
+  static constexpr uint32_t BLOCK_TYPE_SHB = 0x0A0D0D0A;
+  static constexpr uint32_t BLOCK_TYPE_IDB = 0x00000001;
+  static constexpr uint32_t BLOCK_TYPE_EPB = 0x00000006;
+  static constexpr uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+  
+  static constexpr uint16_t OPTION_END = 0;
+  static constexpr uint16_t OPTION_SHB_USERAPPL = 4;
+  static constexpr uint16_t OPTION_IF_NAME = 2;
+  static constexpr uint16_t OPTION_IF_DESCRIPTION = 3;
+  static constexpr uint16_t OPTION_IF_MACADDR = 6;
+  static constexpr uint16_t OPTION_IF_SPEED = 8;
+  static constexpr uint16_t OPTION_IF_TSRESOL = 9;
+  
+  static constexpr uint32_t INTERFACE_ID_NONE = UINT32_MAX;
+  
+  struct Interface
+  {
+    std::string name;
+    std::string description;
+    brawcap_adapter_mac_t mac;
+    uint64_t speedBitsPerSecond;
+    uint32_t snapLength;
+    uint32_t id;
+    uint8_t tsResolution;
+    uint64_t unitsPerSecond;
+    uint32_t nanosecondsPerUnit;
+  };
+  
+private:
+  inline static size_t Pad4(const size_t length)
+  {
+    return (length + 3) & ~static_cast<size_t>(3);
+  }
+  
+  inline static size_t OptionSize(const size_t length)
+  {
+    return 4 + Pad4(length);
+  }
+  
+  inline static char* OptionPut(char* pOut, const uint16_t code, const void* pValue, const size_t length)
+  {
+    const uint16_t header[2] = { code, static_cast<uint16_t>(length) };
+    memcpy(pOut, header, sizeof(header));
+    memcpy(pOut + sizeof(header), pValue, length);
+    memset(pOut + sizeof(header) + length, 0, Pad4(length) - length);
+    return pOut + OptionSize(length);
+  }
+  
+  inline bool SectionHeaderWrite()
+  {
+    static const char application[] = "bRAWcap";
+    const size_t length = 28 + OptionSize(sizeof(application) - 1) + OptionSize(0);
+    char* pBlock = m_file.Reserve(length);
+    if(!pBlock)
+      return false;
+    
+    const uint32_t header[3] = { BLOCK_TYPE_SHB, static_cast<uint32_t>(length), BYTE_ORDER_MAGIC };
+    const uint16_t version[2] = { 1, 0 };
+    const int64_t sectionLength = -1;
+    char* pOut = pBlock;
+    memcpy(pOut, header, sizeof(header));
+    pOut += sizeof(header);
+    memcpy(pOut, version, sizeof(version));
+    pOut += sizeof(version);
+    memcpy(pOut, &sectionLength, sizeof(sectionLength));
+    pOut += sizeof(sectionLength);
+    pOut = OptionPut(pOut, OPTION_SHB_USERAPPL, application, sizeof(application) - 1);
+    pOut = OptionPut(pOut, OPTION_END, nullptr, 0);
+    memcpy(pOut, &header[1], sizeof(uint32_t));
+    m_file.Commit(length);
+    return true;
+  }
+  
+  // Chooses the coarsest decimal unit that represents the timestamp resolution without loss (ns fallback).
+  inline static void ResolutionSet(Interface& entry, const brawcap_timestamp_resolution_ns_t resolutionNs)
+  {
+    entry.tsResolution = 9;
+    entry.unitsPerSecond = 1000000000ULL;
+    entry.nanosecondsPerUnit = 1;
+    uint64_t resolution = resolutionNs;
+    while(resolution && !(resolution % 10) && entry.tsResolution)
+    {
+      resolution /= 10;
+      --entry.tsResolution;
+      entry.unitsPerSecond /= 10;
+      entry.nanosecondsPerUnit *= 10;
+    }
+  }
+  
+  inline bool InterfaceWrite(Interface& entry, const BRAWcapPacketView& packet)
+  {
+    ResolutionSet(entry, packet.TimestampResolutionNs());
+    
+    const size_t length = 20 + OptionSize(entry.name.size()) + OptionSize(entry.description.size()) +
+      OptionSize(sizeof(entry.mac)) + OptionSize(sizeof(uint64_t)) + OptionSize(sizeof(uint8_t)) +
+      OptionSize(0);
+    char* pBlock = m_file.Reserve(length);
+    if(!pBlock)
+      return false;
+    
+    const uint32_t header[2] = { BLOCK_TYPE_IDB, static_cast<uint32_t>(length) };
+    const uint16_t linkType[2] = { LINKTYPE_ETHERNET, 0 };
+    char* pOut = pBlock;
+    memcpy(pOut, header, sizeof(header));
+    pOut += sizeof(header);
+    memcpy(pOut, linkType, sizeof(linkType));
+    pOut += sizeof(linkType);
+    memcpy(pOut, &entry.snapLength, sizeof(entry.snapLength));
+    pOut += sizeof(entry.snapLength);
+    pOut = OptionPut(pOut, OPTION_IF_NAME, entry.name.data(), entry.name.size());
+    pOut = OptionPut(pOut, OPTION_IF_DESCRIPTION, entry.description.data(), entry.description.size());
+    pOut = OptionPut(pOut, OPTION_IF_MACADDR, entry.mac, sizeof(entry.mac));
+    pOut = OptionPut(pOut, OPTION_IF_SPEED, &entry.speedBitsPerSecond, sizeof(uint64_t));
+    pOut = OptionPut(pOut, OPTION_IF_TSRESOL, &entry.tsResolution, sizeof(uint8_t));
+    pOut = OptionPut(pOut, OPTION_END, nullptr, 0);
+    memcpy(pOut, &header[1], sizeof(uint32_t));
+    m_file.Commit(length);
+    
+    entry.id = m_interfacesWritten++;
+    return true;
+  }
+  
+  inline bool PacketWrite(const size_t interfaceIndex, const BRAWcapPacketView& packet)
+  {
+    assert(interfaceIndex < m_interfaces.size());
+    Interface& entry = m_interfaces[interfaceIndex];
+    if(entry.id == INTERFACE_ID_NONE && !InterfaceWrite(entry, packet))
+    {
+      ++m_packetsFailed;
+      return false;
+    }
+    
+    // A snap length of 0 means unlimited in pcapng.
+    const uint32_t captured = entry.snapLength ? std::min<uint32_t>(packet.PayloadLength(), entry.snapLength) :
+      packet.PayloadLength();
+    const size_t length = 32 + Pad4(captured);
+    char* pBlock = m_file.Reserve(length);
+    if(!pBlock)
+    {
+      ++m_packetsFailed;
+      return false;
+    }
+    
+    uint64_t seconds = 0;
+    uint32_t nanoseconds = 0;
+    packet.TimestampNs(seconds, nanoseconds);
+    const uint64_t timestamp = seconds * entry.unitsPerSecond + nanoseconds / entry.nanosecondsPerUnit;
+    
+    const uint32_t header[7] = { BLOCK_TYPE_EPB, static_cast<uint32_t>(length), entry.id,
+      static_cast<uint32_t>(timestamp >> 32), static_cast<uint32_t>(timestamp), captured,
+      std::max<uint32_t>(packet.LengthOnWire(), captured) };
+    memcpy(pBlock, header, sizeof(header));
+    memcpy(pBlock + sizeof(header), packet.Payload(), captured);
+    memset(pBlock + sizeof(header) + captured, 0, Pad4(captured) - captured);
+    memcpy(pBlock + length - sizeof(uint32_t), &header[1], sizeof(uint32_t));
+    const uint64_t offset = m_file.Size();
+    m_file.Commit(length);
+    ++m_packetsWritten;
+    
+    if(m_pIndex)
+      m_pIndex->Add(offset, static_cast<uint32_t>(length), seconds * 1000000000ULL + nanoseconds, packet.Payload(),
+        captured);
+    return true;
+  }
+  
+private:
+  BRAWcapFileWriter m_file;
+  BRAWcapIndexWriter* m_pIndex;
+  std::mutex m_lock;
+  std::vector<Interface> m_interfaces;
+  uint32_t m_interfacesWritten;
+  uint64_t m_packetsWritten;
+  uint64_t m_packetsFailed;
+};
+
+#endif // BRAWCAP_PCAPNG_WRITER_HPP
@@ -28,16 +28,29 @@
 // C
 #include <cstdbool>
 #include <cassert>
+#include <cmath>
 // CPP
 #include <string>
 #include <vector>
+#include <array>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <deque>
+#include <condition_variable>
 
 // bRAWcap
 #include "brawcap_handle.hpp"
 #include "brawcap_adapter.hpp"
 #include "brawcap_buffer.hpp"
 #include "brawcap_filter.hpp"
+#include "brawcap_ring.hpp"
+#include "brawcap_buffer_pool.hpp"
 #endif // INCLUDES
 
 class BRAWcapReceive : virtual public BRAWcapAdapter, virtual public BRAWcapHandle
@@ -45,13 +58,114 @@ class BRAWcapReceive : virtual public BRAWcapAdapter, virtual public BRAWcapHand
 public:
   using RxBufferCompleteCallback = void(*)(BRAWcapBuffer& buffer, brawcap_status_t status, void* pUser);
   
+  // Pass as maxPacketPayloadSize to size buffers by ReceiveSnapLength().
+  static constexpr brawcap_packet_size_t PAYLOAD_SIZE_SNAP = 0;
+  
+  struct PoolStats
+  {
+    uint64_t buffersDelivered;
+    uint64_t buffersDropped;
+    uint64_t packetsDropped;
+    size_t buffersTotal;
+    size_t buffersFree;
+    size_t buffersInUseMax;
+  };
+  
+  enum class AdaptiveReason
+  {
+    RATE,
+    DROPS,
+    LATENCY_LIMIT,
+    CPU_LIMIT
+  };
+  
+  struct AdaptiveLimits
+  {
+    uint32_t maxLatencyMs;
+    uint32_t maxCallbacksPerSecond;
+    brawcap_rx_min_packets_t maxMinPackets;
+    uint32_t intervalMs;
+  };
+  
+  struct AdaptiveTraceEntry
+  {
+    uint64_t timeMs;
+    double packetRate;
+    double callbackRate;
+    double packetsPerBuffer;
+    uint64_t droppedPackets;
+    brawcap_rx_min_packets_t minPacketsOld;
+    brawcap_rx_min_packets_t minPacketsNew;
+    brawcap_rx_timeout_t timeoutOld;
+    brawcap_rx_timeout_t timeoutNew;
+    AdaptiveReason reason;
+  };
+  
+  typedef void(*PollCallback)(BRAWcapPacket* pPackets, const size_t count, void* pUser);
+  
+  enum class PollBackoff
+  {
+    SPIN,
+    YIELD,
+    SLEEP
+  };
+  
+  struct PollConfig
+  {
+    size_t burstSize;
+    brawcap_packet_size_t maxPacketPayloadSize;
+    int cpu; // < 0: no affinity
+    brawcap_rx_timeout_t timeoutMs; // receive timeout while polling, must be non-zero
+    PollBackoff backoff;
+    uint32_t spinRounds;
+    uint32_t sleepMicroseconds;
+  };
+  
+  struct PollStats
+  {
+    uint64_t polls;
+    uint64_t emptyPolls;
+    uint64_t packets;
+    uint64_t burstMax;
+  };
+  
+  struct WorkerStats
+  {
+    uint64_t buffersQueued;
+    uint64_t buffersProcessed;
+    uint64_t buffersDropped;
+    uint64_t packetsDropped;
+    size_t queueOccupancy;
+    size_t queueOccupancyMax;
+    size_t queueCapacity;
+    size_t freeBuffers;
+  };
+  
 public:
   inline BRAWcapReceive(const std::string& name)
-    : BRAWcapAdapter(name), BRAWcapHandle(name)
+    : BRAWcapAdapter(name), BRAWcapHandle(name), m_callback(nullptr), m_pUser(nullptr), m_attachedBuffers(),
+      m_poolBuffersDelivered(0), m_poolBuffersDropped(0), m_poolPacketsDropped(0), m_workersRunning(false),
+      m_workersStopping(false), m_workerBuffersQueued(0), m_workerBuffersProcessed(0), m_workerQueueMax(0),
+      m_adaptiveLimits(), m_adaptiveRunning(false), m_adaptiveCallbacks(0), m_adaptivePackets(0),
+      m_snapLength(BRAWCAP_PACKET_SIZE_MAX), m_captureOffset(0), m_pollCallback(nullptr), m_pPollUser(nullptr),
+      m_pollConfig(), m_pollTimeoutSaved(0), m_pollRunning(false), m_polls(0), m_pollsEmpty(0), m_pollPackets(0),
+      m_pollBurstMax(0)
   { }
   
   inline ~BRAWcapReceive()
   {
+    if(m_pollRunning)
+      ReceivePollStop();
+    
+    if(m_adaptiveRunning)
+      ReceiveAdaptiveStop();
+    
+    if(m_workersRunning)
+      ReceiveStop();
+    
+    if(m_pPool)
+      ReceiveBufferPoolDestroy();
+    
     while (!m_buffers.empty())
       ReceiveBufferRemove();
   }
@@ -63,6 +177,82 @@ public:
     return !BRAWCAP_ERROR(status);
   }
   
+  // Receives up to count packets, returns early on the first receive without data (timeout).
+  // The C API has no batched single-packet receive, so a burst still makes one driver call per packet and only
+  // amortizes the caller's per-packet overhead. Each call blocks up to the receive timeout (0 waits forever).
+  inline size_t ReceiveBurst(BRAWcapPacket* pPackets, const size_t count)
+  {
+    brawcap_handle_t* pHandle = BRAWcapHandle::Native().get();
+    size_t received = 0;
+    for(; received < count; ++received)
+    {
+      const brawcap_status_t status = brawcap_rx_packet(pHandle, pPackets[received].ResolvePacket());
+      assert(!BRAWCAP_ERROR(status));
+      // Warnings (pending receive, demo mode) and the no data info do not deliver a packet.
+      if(!BRAWCAP_SUCCESS(status))
+        break;
+    }
+    return received;
+  }
+  
+  inline size_t ReceiveBurst(std::vector<BRAWcapPacket>& packets)
+  {
+    return packets.empty() ? 0 : ReceiveBurst(packets.data(), packets.size());
+  }
+  
+  // Appends received packets to the buffer until it is full or no more data is pending.
+  inline size_t ReceiveBurst(BRAWcapBuffer& buffer)
+  {
+    if(!m_pBurstPacket)
+      m_pBurstPacket = std::make_unique<BRAWcapPacket>(m_snapLength);
+    
+    const size_t count = buffer.Capacity() - buffer.Count();
+    size_t received = 0;
+    for(; received < count; ++received)
+    {
+      if(!ReceiveBurst(m_pBurstPacket.get(), 1))
+        break;
+      if(!buffer.PushBack(*m_pBurstPacket))
+        break;
+    }
+    return received;
+  }
+  
+  // Polls with the configured receive timeout, which also bounds the latency of an empty poll and of the stop.
+  // The previous timeout is restored by ReceivePollStop.
+  inline void ReceivePollStart(PollCallback callback, void* pUser, const PollConfig& config)
+  {
+    assert(callback && config.burstSize && config.maxPacketPayloadSize);
+    assert(config.timeoutMs && config.timeoutMs <= BRAWCAP_RX_TIMEOUT_MS_MAX);
+    assert(config.cpu < 64);
+    assert(!m_pollRunning && !m_callback);
+    m_pollCallback = callback;
+    m_pPollUser = pUser;
+    m_pollConfig = config;
+    m_pollTimeoutSaved = ReceiveTimeoutMilliseconds();
+    ReceiveTimeoutMillisecondsSet(config.timeoutMs);
+    m_pollRunning = true;
+    m_poller = std::thread(&BRAWcapReceive::ReceivePollLoop, this);
+  }
+  
+  inline void ReceivePollStop()
+  {
+    assert(m_pollRunning);
+    m_pollRunning = false;
+    m_poller.join();
+    ReceiveTimeoutMillisecondsSet(m_pollTimeoutSaved);
+    m_pollCallback = nullptr;
+    m_pPollUser = nullptr;
+  }
+  
+  inline void ReceivePollStatistics(PollStats& stats) const
+  {
+    stats.polls = m_polls.load(std::memory_order_relaxed);
+    stats.emptyPolls = m_pollsEmpty.load(std::memory_order_relaxed);
+    stats.packets = m_pollPackets.load(std::memory_order_relaxed);
+    stats.burstMax = m_pollBurstMax.load(std::memory_order_relaxed);
+  }
+  
   inline void ReceiveStart(RxBufferCompleteCallback callback, void* pUser)
   {
     assert(callback);
@@ -72,20 +262,114 @@ public:
       assert(false);
   }
   
+  inline void ReceivePooledStart(RxBufferCompleteCallback callback, void* pUser)
+  {
+    assert(callback && m_pPool && !m_workersRunning);
+    m_callback = callback;
+    m_pUser = pUser;
+    if(!BRAWCAP_SUCCESS(brawcap_rx_start(BRAWcapHandle::Native().get(), ReceiveBufferCompletePooled, this, false)))
+      assert(false);
+  }
+  
+  inline void ReceiveWorkersStart(RxBufferCompleteCallback callback, void* pUser, const size_t numWorkers)
+  {
+    assert(callback && numWorkers && m_pPool && !m_workersRunning);
+    m_callback = callback;
+    m_pUser = pUser;
+    
+    m_pCompletedBuffers = std::make_unique<BRAWcapRing<CompletedBuffer>>(m_pPool->Size());
+    m_workerBuffersQueued = 0;
+    m_workerBuffersProcessed = 0;
+    m_workerQueueMax = 0;
+    m_workersStopping = false;
+    m_workersRunning = true;
+    for(size_t index = 0; index < numWorkers; ++index)
+      m_workers.emplace_back(&BRAWcapReceive::ReceiveWorkerLoop, this);
+    
+    if(!BRAWCAP_SUCCESS(brawcap_rx_start(BRAWcapHandle::Native().get(), ReceiveBufferCompleteWorkers, this, false)))
+      assert(false);
+  }
+  
   inline void ReceiveStop()
   {
     if(!BRAWCAP_SUCCESS(brawcap_rx_stop(BRAWcapHandle::Native().get())))
       assert(false);
     
+    if(m_workersRunning)
+      ReceiveWorkersShutdown();
+    
     m_callback = nullptr;
     m_pUser = nullptr;
   }
   
+  inline void ReceiveWorkerStatistics(WorkerStats& stats) const
+  {
+    stats.buffersQueued = m_workerBuffersQueued.load(std::memory_order_relaxed);
+    stats.buffersProcessed = m_workerBuffersProcessed.load(std::memory_order_relaxed);
+    stats.buffersDropped = m_poolBuffersDropped.load(std::memory_order_relaxed);
+    stats.packetsDropped = m_poolPacketsDropped.load(std::memory_order_relaxed);
+    stats.queueOccupancy = m_pCompletedBuffers ? m_pCompletedBuffers->Size() : 0;
+    stats.queueOccupancyMax = m_workerQueueMax.load(std::memory_order_relaxed);
+    stats.queueCapacity = m_pCompletedBuffers ? m_pCompletedBuffers->Capacity() : 0;
+    stats.freeBuffers = m_pPool ? m_pPool->Available() : 0;
+  }
+  
+  inline void ReceiveBufferPoolCreate(const brawcap_packet_size_t maxPacketPayloadSize,
+    const brawcap_buffer_packet_count_t numPackets, const size_t numBuffers)
+  {
+    assert(m_buffers.empty() && !m_pPool && numBuffers > m_attachedBuffers.size());
+    std::lock_guard<std::mutex> localLock(m_bufferLock);
+    m_pPool = std::make_unique<BRAWcapBufferPool>(PayloadSize(maxPacketPayloadSize), numPackets, numBuffers);
+    m_poolBuffersDelivered = 0;
+    m_poolBuffersDropped = 0;
+    m_poolPacketsDropped = 0;
+    for(auto& attached : m_attachedBuffers)
+    {
+      BRAWcapBuffer* pBuffer = m_pPool->Acquire();
+      brawcap_status_t status = brawcap_rx_buffer_attach(BRAWcapHandle::Native().get(), pBuffer->m_pBuffer.get());
+      assert(!BRAWCAP_ERROR(status));
+      attached.store(pBuffer, std::memory_order_release);
+    }
+  }
+  
+  inline void ReceiveBufferPoolDestroy()
+  {
+    assert(m_pPool && !m_workersRunning);
+    std::lock_guard<std::mutex> localLock(m_bufferLock);
+    for(auto& attached : m_attachedBuffers)
+    {
+      BRAWcapBuffer* pAttached = attached.exchange(nullptr);
+      if(!pAttached)
+        continue;
+      brawcap_status_t status = brawcap_rx_buffer_detach(BRAWcapHandle::Native().get(), pAttached->m_pBuffer.get());
+      assert(!BRAWCAP_ERROR(status));
+      m_pPool->Release(pAttached);
+    }
+    m_pPool.reset();
+  }
+  
+  inline void ReceiveBufferRelease(BRAWcapBuffer& buffer)
+  {
+    assert(m_pPool);
+    m_pPool->Release(&buffer);
+  }
+  
+  inline void ReceiveBufferPoolStatistics(PoolStats& stats) const
+  {
+    stats.buffersDelivered = m_poolBuffersDelivered.load(std::memory_order_relaxed);
+    stats.buffersDropped = m_poolBuffersDropped.load(std::memory_order_relaxed);
+    stats.packetsDropped = m_poolPacketsDropped.load(std::memory_order_relaxed);
+    stats.buffersTotal = m_pPool ? m_pPool->Size() : 0;
+    stats.buffersFree = m_pPool ? m_pPool->Available() : 0;
+    stats.buffersInUseMax = m_pPool ? m_pPool->InUseMax() : 0;
+  }
+  
   inline void ReceiveBufferAdd(const brawcap_packet_size_t maxPacketPayloadSize,
     const brawcap_buffer_packet_count_t numPackets)
   {
+    assert(!m_pPool);
     std::lock_guard<std::mutex> localLock(m_bufferLock);
-    BRAWcapBuffer buffer(maxPacketPayloadSize, numPackets);
+    BRAWcapBuffer buffer(PayloadSize(maxPacketPayloadSize), numPackets);
     m_buffers.push_back(buffer);
     brawcap_status_t status = brawcap_rx_buffer_attach(BRAWcapHandle::Native().get(), buffer.m_pBuffer.get());
     assert(!BRAWCAP_ERROR(status));
@@ -141,10 +425,60 @@ public:
     return timeout_ms;
   }
   
+  inline void ReceiveAdaptiveStart(const AdaptiveLimits& limits)
+  {
+    assert(limits.maxLatencyMs && limits.maxCallbacksPerSecond && limits.maxMinPackets && limits.intervalMs);
+    assert(!m_adaptiveRunning);
+    m_adaptiveLimits = limits;
+    // The driver rejects timeouts above BRAWCAP_RX_TIMEOUT_MS_MAX, so a larger latency budget cannot be honoured.
+    m_adaptiveLimits.maxLatencyMs = std::min<uint32_t>(limits.maxLatencyMs, BRAWCAP_RX_TIMEOUT_MS_MAX);
+    {
+      std::lock_guard<std::mutex> localLock(m_adaptiveLock);
+      m_adaptiveTrace.clear();
+    }
+    m_adaptiveRunning = true;
+    m_adaptiveController = std::thread(&BRAWcapReceive::ReceiveAdaptiveLoop, this);
+  }
+  
+  inline void ReceiveAdaptiveStop()
+  {
+    assert(m_adaptiveRunning);
+    {
+      std::lock_guard<std::mutex> localLock(m_adaptiveLock);
+      m_adaptiveRunning = false;
+    }
+    m_adaptiveWakeup.notify_all();
+    m_adaptiveController.join();
+  }
+  
+  inline std::vector<AdaptiveTraceEntry> ReceiveAdaptiveTrace() const
+  {
+    std::lock_guard<std::mutex> localLock(m_adaptiveLock);
+    return std::vector<AdaptiveTraceEntry>(m_adaptiveTrace.begin(), m_adaptiveTrace.end());
+  }
+  
+  // Also takes over the capture length of the filter, see ReceiveSnapLength().
   inline void ReceiveFilterSet(const BRAWcapFilter& filter)
   {
     brawcap_status_t status = brawcap_rx_filter_set(BRAWcapHandle::Native().get(), filter.m_pFilter.get());
     assert(!BRAWCAP_ERROR(status));
+    m_snapLength = filter.CaptureSnapLength();
+    m_captureOffset = filter.m_captureByteOffset;
+    m_pBurstPacket.reset();
+  }
+  
+  // Bytes the driver stores per received packet. Buffers only need this payload size and capture sinks should use
+  // it as their snap length, the original size stays available through LengthOnWire().
+  inline brawcap_packet_size_t ReceiveSnapLength() const
+  {
+    return m_snapLength;
+  }
+  
+  // Offset into the frame at which the stored bytes start. A non-zero offset strips the start of every frame, such
+  // packets are no valid Ethernet records and must not be written to a pcap/pcapng file with an Ethernet link type.
+  inline brawcap_packet_size_t ReceiveCaptureOffset() const
+  {
+    return m_captureOffset;
   }
   
   inline BRAWcapFilter ReceiveFilter()
@@ -229,28 +563,374 @@ public:
     return size;
   }
   
-private:
+protected:
+  inline brawcap_packet_size_t PayloadSize(const brawcap_packet_size_t maxPacketPayloadSize) const
+  {
+    return maxPacketPayloadSize == PAYLOAD_SIZE_SNAP ? m_snapLength : maxPacketPayloadSize;
+  }
+  
+  inline BRAWcapBuffer* ReceiveBufferLookup(brawcap_buffer_t* const pBuffer)
+  {
+    for(auto& buffer : m_buffers)
+    {
+      if(buffer.m_pBuffer.get() == pBuffer)
+      {
+        ReceiveAccount(buffer);
+        return &buffer;
+      }
+    }
+    return nullptr;
+  }
+  
+  inline void ReceiveAccount(BRAWcapBuffer& buffer)
+  {
+    if(!m_adaptiveRunning.load(std::memory_order_relaxed))
+      return;
+    m_adaptiveCallbacks.fetch_add(1, std::memory_order_relaxed);
+    m_adaptivePackets.fetch_add(buffer.Count(), std::memory_order_relaxed);
+  }
+  
+  // Completion entry point of ReceiveStart(), protected so derived classes can wrap it.
   inline static void ReceiveBufferCompleteInternal(brawcap_handle_t* const pHandle, const brawcap_status_t status,
     brawcap_buffer_t* const pBuffer, void* pUser)
   {
     BRAWcapReceive* pReceive = reinterpret_cast<BRAWcapReceive*>(pUser);
-    for(auto buffer : pReceive->m_buffers)
+    BRAWcapBuffer* pCompleted = pReceive->ReceiveBufferLookup(pBuffer);
+    if(pCompleted && pReceive->m_callback)
+      pReceive->m_callback(*pCompleted, status, pReceive->m_pUser);
+  }
+  
+private:
+  inline BRAWcapBuffer* ReceiveBufferRotate(brawcap_handle_t* const pHandle, brawcap_buffer_t* const pBuffer)
+  {
+    for(auto& attached : m_attachedBuffers)
+    {
+      BRAWcapBuffer* pCompleted = attached.load(std::memory_order_acquire);
+      if(!pCompleted || pCompleted->m_pBuffer.get() != pBuffer)
+        continue;
+      
+      ReceiveAccount(*pCompleted);
+      
+      // Pool exhausted: the completed buffer stays attached and will be overwritten by the driver.
+      BRAWcapBuffer* pFree = m_pPool->Acquire();
+      if(!pFree)
+      {
+        m_poolBuffersDropped.fetch_add(1, std::memory_order_relaxed);
+        m_poolPacketsDropped.fetch_add(pCompleted->Count(), std::memory_order_relaxed);
+        return nullptr;
+      }
+      
+      brawcap_status_t status = brawcap_rx_buffer_detach(pHandle, pBuffer);
+      assert(!BRAWCAP_ERROR(status));
+      status = brawcap_rx_buffer_attach(pHandle, pFree->m_pBuffer.get());
+      assert(!BRAWCAP_ERROR(status));
+      attached.store(pFree, std::memory_order_release);
+      m_poolBuffersDelivered.fetch_add(1, std::memory_order_relaxed);
+      return pCompleted;
+    }
+    return nullptr;
+  }
+  
+  inline static void ReceiveBufferCompletePooled(brawcap_handle_t* const pHandle, const brawcap_status_t status,
+    brawcap_buffer_t* const pBuffer, void* pUser)
+  {
+    BRAWcapReceive* pReceive = reinterpret_cast<BRAWcapReceive*>(pUser);
+    BRAWcapBuffer* pCompleted = pReceive->ReceiveBufferRotate(pHandle, pBuffer);
+    if(pCompleted)
+      pReceive->m_callback(*pCompleted, status, pReceive->m_pUser);
+  }
+  
+  inline static void ReceiveBufferCompleteWorkers(brawcap_handle_t* const pHandle, const brawcap_status_t status,
+    brawcap_buffer_t* const pBuffer, void* pUser)
+  {
+    BRAWcapReceive* pReceive = reinterpret_cast<BRAWcapReceive*>(pUser);
+    BRAWcapBuffer* pCompleted = pReceive->ReceiveBufferRotate(pHandle, pBuffer);
+    if(!pCompleted)
+      return;
+    
+    // Ring capacity covers the whole pool, therefore the push can not fail.
+    const bool pushed = pReceive->m_pCompletedBuffers->TryPush({ pCompleted, status });
+    assert(pushed);
+    pReceive->m_workerBuffersQueued.fetch_add(1, std::memory_order_relaxed);
+    
+    const size_t occupancy = pReceive->m_pCompletedBuffers->Size();
+    size_t occupancyMax = pReceive->m_workerQueueMax.load(std::memory_order_relaxed);
+    while(occupancy > occupancyMax
+      && !pReceive->m_workerQueueMax.compare_exchange_weak(occupancyMax, occupancy, std::memory_order_relaxed))
+    { }
+  }
+  
+  inline void ReceiveWorkerLoop()
+  {
+    uint32_t idleRounds = 0;
+    for(;;)
     {
-      if (!pReceive->m_callback)
+      CompletedBuffer completed;
+      if(m_pCompletedBuffers->TryPop(completed))
+      {
+        idleRounds = 0;
+        m_callback(*completed.pBuffer, completed.status, m_pUser);
+        m_pPool->Release(completed.pBuffer);
+        m_workerBuffersProcessed.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      
+      if(m_workersStopping.load(std::memory_order_acquire))
         break;
-      if(buffer.m_pBuffer.get() == pBuffer)
+      
+      if(++idleRounds < 64)
+        std::this_thread::yield();
+      else
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  }
+  
+  inline void ReceivePollLoop()
+  {
+    const PollConfig config = m_pollConfig;
+    if(config.cpu >= 0)
+    {
+      if(!SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << config.cpu))
+        assert(false);
+      SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    }
+    
+    std::vector<BRAWcapPacket> packets;
+    packets.reserve(config.burstSize);
+    for(size_t index = 0; index < config.burstSize; ++index)
+      packets.emplace_back(config.maxPacketPayloadSize);
+    
+    uint32_t idleRounds = 0;
+    while(m_pollRunning.load(std::memory_order_relaxed))
+    {
+      const size_t received = ReceiveBurst(packets);
+      m_polls.fetch_add(1, std::memory_order_relaxed);
+      if(received)
       {
-        pReceive->m_callback(buffer, status, pReceive->m_pUser);
+        idleRounds = 0;
+        m_pollPackets.fetch_add(received, std::memory_order_relaxed);
+        if(received > m_pollBurstMax.load(std::memory_order_relaxed))
+          m_pollBurstMax.store(received, std::memory_order_relaxed);
+        m_pollCallback(packets.data(), received, m_pPollUser);
+        continue;
+      }
+      
+      m_pollsEmpty.fetch_add(1, std::memory_order_relaxed);
+      if(config.backoff == PollBackoff::SPIN || ++idleRounds < config.spinRounds)
+        continue;
+      if(config.backoff == PollBackoff::YIELD)
+        std::this_thread::yield();
+      else
+        std::this_thread::sleep_for(std::chrono::microseconds(config.sleepMicroseconds));
+    }
+  }
+  
+  inline void ReceiveAdaptiveLoop()
+  {
+    brawcap_stats_rx_t stats = {};
+    stats.header.type = BRAWCAP_STATS_TYPE_RX;
+    stats.header.revision = BRAWCAP_STATS_RX_REVISION_1;
+    stats.header.size = BRAWCAP_STATS_RX_SIZEOF_REVISION_1;
+    StatsReceiveStatistics(stats);
+    uint64_t lastDropped = stats.handleDroppedPacketsTotal;
+    uint64_t lastCallbacks = m_adaptiveCallbacks.load(std::memory_order_relaxed);
+    uint64_t lastPackets = m_adaptivePackets.load(std::memory_order_relaxed);
+    
+    const auto start = std::chrono::steady_clock::now();
+    auto last = start;
+    std::unique_lock<std::mutex> localLock(m_adaptiveLock);
+    while(m_adaptiveRunning)
+    {
+      m_adaptiveWakeup.wait_for(localLock, std::chrono::milliseconds(m_adaptiveLimits.intervalMs));
+      if(!m_adaptiveRunning)
         break;
+      localLock.unlock();
+      
+      const auto now = std::chrono::steady_clock::now();
+      const double seconds = std::chrono::duration<double>(now - last).count();
+      last = now;
+      
+      StatsReceiveStatistics(stats);
+      const uint64_t callbacks = m_adaptiveCallbacks.load(std::memory_order_relaxed);
+      const uint64_t packets = m_adaptivePackets.load(std::memory_order_relaxed);
+      
+      AdaptiveTraceEntry entry = {};
+      entry.timeMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
+      entry.packetRate = seconds > 0 ? (packets - lastPackets) / seconds : 0;
+      entry.callbackRate = seconds > 0 ? (callbacks - lastCallbacks) / seconds : 0;
+      entry.packetsPerBuffer = callbacks != lastCallbacks ? double(packets - lastPackets) / (callbacks - lastCallbacks) : 0;
+      entry.droppedPackets = stats.handleDroppedPacketsTotal - lastDropped;
+      entry.minPacketsOld = ReceiveMinPackets();
+      entry.timeoutOld = ReceiveTimeoutMilliseconds();
+      lastDropped = stats.handleDroppedPacketsTotal;
+      lastCallbacks = callbacks;
+      lastPackets = packets;
+      
+      ReceiveAdaptiveAdjust(entry);
+      
+      localLock.lock();
+      if(entry.minPacketsNew != entry.minPacketsOld || entry.timeoutNew != entry.timeoutOld)
+      {
+        if(m_adaptiveTrace.size() >= ADAPTIVE_TRACE_MAX)
+          m_adaptiveTrace.pop_front();
+        m_adaptiveTrace.push_back(entry);
       }
     }
   }
   
+  inline void ReceiveAdaptiveAdjust(AdaptiveTraceEntry& entry)
+  {
+    const AdaptiveLimits& limits = m_adaptiveLimits;
+    
+    // Bounds for the batch size: the CPU limit asks for at least this many packets per callback, the latency limit
+    // allows at most as many as arrive within the latency budget.
+    const double cpuBound = entry.packetRate / limits.maxCallbacksPerSecond;
+    const double latencyBound = entry.packetRate * limits.maxLatencyMs / 1000.0;
+    
+    double target = std::max(1.0, cpuBound);
+    entry.reason = AdaptiveReason::RATE;
+    if(entry.droppedPackets)
+    {
+      target = std::max(target, 2.0 * entry.minPacketsOld);
+      entry.reason = AdaptiveReason::DROPS;
+    }
+    if(target > latencyBound)
+    {
+      target = std::max(1.0, latencyBound);
+      entry.reason = cpuBound > latencyBound ? AdaptiveReason::CPU_LIMIT : AdaptiveReason::LATENCY_LIMIT;
+    }
+    target = std::min(target, static_cast<double>(limits.maxMinPackets));
+    
+    // Move half way to the target and ignore changes below ~10% to avoid oscillation.
+    const double current = std::max<double>(1.0, entry.minPacketsOld);
+    const double next = current + (target - current) / 2.0;
+    entry.minPacketsNew = entry.minPacketsOld;
+    if(std::abs(next - current) > current / 10.0)
+    {
+      entry.minPacketsNew = static_cast<brawcap_rx_min_packets_t>(std::max(1.0, next + 0.5));
+      ReceiveMinPacketsSet(entry.minPacketsNew);
+    }
+    
+    // Timeout: twice the expected fill time of a batch, but never beyond the latency budget.
+    double timeoutMs = limits.maxLatencyMs;
+    if(entry.packetRate > 0)
+      timeoutMs = std::min(timeoutMs, 2000.0 * entry.minPacketsNew / entry.packetRate);
+    timeoutMs = std::min(std::max(1.0, timeoutMs), static_cast<double>(BRAWCAP_RX_TIMEOUT_MS_MAX));
+    entry.timeoutNew = static_cast<brawcap_rx_timeout_t>(timeoutMs + 0.5);
+    if(entry.timeoutNew != entry.timeoutOld)
+      ReceiveTimeoutMillisecondsSet(entry.timeoutNew);
+  }
+  
+  inline void ReceiveWorkersShutdown()
+  {
+    m_workersStopping = true;
+    for(auto& worker : m_workers)
+      worker.join();
+    m_workers.clear();
+    m_pCompletedBuffers.reset();
+    m_workersRunning = false;
+  }
+  
+private:
+  struct CompletedBuffer
+  {
+    BRAWcapBuffer* pBuffer;
+    brawcap_status_t status;
+  };
+  
 private:
   std::vector<BRAWcapBuffer> m_buffers;
   std::mutex m_bufferLock;
   RxBufferCompleteCallback m_callback;
   void* m_pUser;
+  
+  // Pooled mode
+  std::unique_ptr<BRAWcapBufferPool> m_pPool;
+  std::array<std::atomic<BRAWcapBuffer*>, BRAWCAP_RX_BUFFERS_PER_HANDLE_MAX> m_attachedBuffers;
+  std::atomic<uint64_t> m_poolBuffersDelivered;
+  std::atomic<uint64_t> m_poolBuffersDropped;
+  std::atomic<uint64_t> m_poolPacketsDropped;
+  
+  // Worker mode
+  std::unique_ptr<BRAWcapRing<CompletedBuffer>> m_pCompletedBuffers;
+  std::vector<std::thread> m_workers;
+  std::atomic<bool> m_workersRunning;
+  std::atomic<bool> m_workersStopping;
+  std::atomic<uint64_t> m_workerBuffersQueued;
+  std::atomic<uint64_t> m_workerBuffersProcessed;
+  std::atomic<size_t> m_workerQueueMax;
+  
+  // Adaptive tuning
+  static constexpr size_t ADAPTIVE_TRACE_MAX = 4096;
+  AdaptiveLimits m_adaptiveLimits;
+  std::atomic<bool> m_adaptiveRunning;
+  std::atomic<uint64_t> m_adaptiveCallbacks;
+  std::atomic<uint64_t> m_adaptivePackets;
+  std::thread m_adaptiveController;
+  mutable std::mutex m_adaptiveLock;
+  std::condition_variable m_adaptiveWakeup;
+  std::deque<AdaptiveTraceEntry> m_adaptiveTrace;
+  
+  brawcap_packet_size_t m_snapLength;
+  brawcap_packet_size_t m_captureOffset;
+  
+  // Burst / busy polling
+  std::unique_ptr<BRAWcapPacket> m_pBurstPacket;
+  PollCallback m_pollCallback;
+  void* m_pPollUser;
+  PollConfig m_pollConfig;
+  brawcap_rx_timeout_t m_pollTimeoutSaved;
+  std::thread m_poller;
+  std::atomic<bool> m_pollRunning;
+  std::atomic<uint64_t> m_polls;
+  std::atomic<uint64_t> m_pollsEmpty;
+  std::atomic<uint64_t> m_pollPackets;
+  std::atomic<uint64_t> m_pollBurstMax;
+};
+
+template<typename Handler>
+class BRAWcapReceiveT : public BRAWcapReceive
+{
+  static_assert(std::is_invocable<Handler&, BRAWcapBuffer&, brawcap_status_t>::value
+    || std::is_invocable<Handler&, BRAWcapBuffer&>::value,
+    "Handler must be callable with (BRAWcapBuffer&, brawcap_status_t) or (BRAWcapBuffer&).");
+  
+public:
+  inline BRAWcapReceiveT(const std::string& name, Handler handler = Handler())
+    : BRAWcapAdapter(name), BRAWcapHandle(name), BRAWcapReceive(name), m_handler(std::move(handler))
+  { }
+  
+  inline ~BRAWcapReceiveT()
+  { }
+  
+  inline void ReceiveStart()
+  {
+    if(!BRAWCAP_SUCCESS(brawcap_rx_start(BRAWcapHandle::Native().get(), ReceiveBufferCompleteT, this, true)))
+      assert(false);
+  }
+  
+  inline Handler& ReceiveHandler()
+  {
+    return m_handler;
+  }
+  
+protected:
+  inline static void ReceiveBufferCompleteT(brawcap_handle_t* const pHandle, const brawcap_status_t status,
+    brawcap_buffer_t* const pBuffer, void* pUser)
+  {
+    BRAWcapReceiveT* pReceive = reinterpret_cast<BRAWcapReceiveT*>(pUser);
+    BRAWcapBuffer* pCompleted = pReceive->ReceiveBufferLookup(pBuffer);
+    if(!pCompleted)
+      return;
+    
+    if constexpr(std::is_invocable<Handler&, BRAWcapBuffer&, brawcap_status_t>::value)
+      pReceive->m_handler(*pCompleted, status);
+    else if(BRAWCAP_SUCCESS(status))
+      pReceive->m_handler(*pCompleted);
+  }
+  
+private:
+  Handler m_handler;
 };
 
 #endif // BRAWCAP_RECEIVE_HPP
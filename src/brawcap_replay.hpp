@@ -0,0 +1,430 @@
+/**
+ * @file brawcap_replay.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Replay (timestamp faithful capture file replay).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_REPLAY_HPP
+#define BRAWCAP_REPLAY_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cassert>
+// CPP
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet.hpp"
+#include "brawcap_transmit.hpp"
+#include "brawcap_file_reader.hpp"
+#include "brawcap_clock.hpp"
+#include "brawcap_ring.hpp"
+#endif // INCLUDES
+
+// Replays a capture file through BRAWcapTransmit with the recorded timing. A fill thread packs the upcoming packets
+// into transmit buffers ahead of time, a pacing thread hands each buffer to the driver when the recorded time of its
+// first packet is due. Gaps inside a buffer are paced by the driver (synchronized send), long gaps split buffers so
+// they are paced by the clock. The replay owns the transmit callback while running.
+class BRAWcapReplay
+{
+public:
+  // Bucket 0 counts errors below 1us, bucket i errors in [2^(i-1), 2^i) us, the last bucket everything above.
+  static constexpr size_t ERROR_BUCKETS = 24;
+  
+  struct Config
+  {
+    double speed = 1.0; // 2.0 replays twice as fast
+    uint32_t loops = 1; // 0: until Stop()
+    bool topSpeed = false; // ignore the recorded timing
+    uint64_t splitGapNs = 1000000; // gaps above start a new buffer, paced by the clock
+    brawcap_packet_size_t maxPacketPayloadSize = BRAWCAP_PACKET_SIZE_MAX;
+    brawcap_buffer_packet_count_t packetsPerBuffer = 256;
+    size_t bufferCount = 16;
+  };
+  
+  struct Stats
+  {
+    uint64_t packetsSent;
+    uint64_t bytesSent;
+    uint64_t buffersSent;
+    uint64_t packetsSkipped; // empty or larger than maxPacketPayloadSize
+    uint64_t loopsCompleted;
+    uint64_t underruns; // a buffer was due but not filled yet
+    uint64_t transmitErrors;
+    uint64_t errorMaxNs;
+    uint64_t errorMeanNs;
+    uint64_t errorHistogram[ERROR_BUCKETS];
+  };
+  
+public:
+  inline BRAWcapReplay(BRAWcapTransmit& transmit, const Config& config, BRAWcapClock* pClock = nullptr)
+    : m_transmit(transmit), m_config(config), m_pClock(pClock), m_packet(config.maxPacketPayloadSize),
+      m_freeBuffers(config.bufferCount), m_readyBuffers(config.bufferCount), m_inFlight(0), m_running(false),
+      m_stopping(false), m_fillDone(false), m_finished(false), m_packetsSent(0), m_bytesSent(0), m_buffersSent(0),
+      m_packetsSkipped(0), m_loopsCompleted(0), m_underruns(0), m_transmitErrors(0), m_errorMaxNs(0), m_errorSumNs(0),
+      m_errorHistogram()
+  {
+    assert(m_config.speed > 0.0 && m_config.bufferCount >= 2);
+    if(!m_pClock)
+    {
+      m_pOwnClock = std::make_unique<BRAWcapSteadyClock>();
+      m_pClock = m_pOwnClock.get();
+    }
+    
+    m_buffers.reserve(m_config.bufferCount);
+    for(size_t index = 0; index < m_config.bufferCount; ++index)
+    {
+      m_buffers.push_back(Slot{ BRAWcapBuffer(m_config.maxPacketPayloadSize, m_config.packetsPerBuffer), 0, 0, 0 });
+      m_slotOfBuffer.emplace(m_buffers.back().buffer.m_pBuffer.get(), index);
+      m_freeBuffers.TryPush(index);
+    }
+  }
+  
+  inline ~BRAWcapReplay()
+  {
+    if(m_running)
+      Stop();
+  }
+  
+  BRAWcapReplay(const BRAWcapReplay&) = delete;
+  BRAWcapReplay& operator=(const BRAWcapReplay&) = delete;
+  
+  inline bool Open(const std::string& path)
+  {
+    assert(!m_running);
+    if(m_file.IsOpen())
+      m_file.Close();
+    return m_file.Open(path);
+  }
+  
+  // Statistics cover the run started last.
+  inline void Start()
+  {
+    assert(m_file.IsOpen() && !m_running && !m_inFlight);
+    m_stopping = false;
+    m_fillDone = false;
+    m_finished = false;
+    m_packetsSent = 0;
+    m_bytesSent = 0;
+    m_buffersSent = 0;
+    m_packetsSkipped = 0;
+    m_loopsCompleted = 0;
+    m_underruns = 0;
+    m_transmitErrors = 0;
+    m_errorMaxNs = 0;
+    m_errorSumNs = 0;
+    for(auto& bucket : m_errorHistogram)
+      bucket = 0;
+    m_running = true;
+    const bool started = m_transmit.TransmitStart(TransmitBufferComplete, this);
+    assert(started);
+    m_fillThread = std::thread(&BRAWcapReplay::FillLoop, this);
+    m_paceThread = std::thread(&BRAWcapReplay::PaceLoop, this);
+  }
+  
+  // Blocks until all loops are sent and completed by the driver. Never returns for endless loops.
+  inline void Wait()
+  {
+    assert(m_running);
+    m_paceThread.join();
+    m_fillThread.join();
+    
+    // A stopped pace thread leaves buffers in flight and filled ones unsent, all go back to the free ring.
+    uint32_t idleRounds = 0;
+    while(m_inFlight.load(std::memory_order_acquire))
+      Backoff(idleRounds);
+    m_transmit.TransmitStop();
+    size_t index = 0;
+    while(m_readyBuffers.TryPop(index))
+    {
+      m_buffers[index].buffer.Clear();
+      m_freeBuffers.TryPush(index);
+    }
+    m_running = false;
+  }
+  
+  inline void Stop()
+  {
+    m_stopping = true;
+    Wait();
+  }
+  
+  inline bool Finished() const
+  {
+    return m_finished;
+  }
+  
+  inline void Statistics(Stats& stats) const
+  {
+    stats.packetsSent = m_packetsSent.load(std::memory_order_relaxed);
+    stats.bytesSent = m_bytesSent.load(std::memory_order_relaxed);
+    stats.buffersSent = m_buffersSent.load(std::memory_order_relaxed);
+    stats.packetsSkipped = m_packetsSkipped.load(std::memory_order_relaxed);
+    stats.loopsCompleted = m_loopsCompleted.load(std::memory_order_relaxed);
+    stats.underruns = m_underruns.load(std::memory_order_relaxed);
+    stats.transmitErrors = m_transmitErrors.load(std::memory_order_relaxed);
+    stats.errorMaxNs = m_errorMaxNs.load(std::memory_order_relaxed);
+    stats.errorMeanNs = stats.buffersSent ? m_errorSumNs.load(std::memory_order_relaxed) / stats.buffersSent : 0;
+    for(size_t bucket = 0; bucket < ERROR_BUCKETS; ++bucket)
+      stats.errorHistogram[bucket] = m_errorHistogram[bucket].load(std::memory_order_relaxed);
+  }
+  
+  inline static size_t ErrorBucket(const uint64_t errorNs)
+  {
+    size_t bucket = 0;
+    for(uint64_t us = errorNs / 1000; us && bucket < ERROR_BUCKETS - 1; us >>= 1)
+      ++bucket;
+    return bucket;
+  }
+  
+private:
+  struct Slot
+  {
+    BRAWcapBuffer buffer;
+    uint64_t dueNs; // relative to the replay start, already scaled
+    uint64_t packets;
+    uint64_t bytes;
+  };
+  
+private:
+  inline void Backoff(uint32_t& idleRounds)
+  {
+    if(++idleRounds < 64)
+      std::this_thread::yield();
+    else
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  
+  inline bool SlotAcquire(size_t& index)
+  {
+    uint32_t idleRounds = 0;
+    while(!m_freeBuffers.TryPop(index))
+    {
+      if(m_stopping)
+        return false;
+      Backoff(idleRounds);
+    }
+    return true;
+  }
+  
+  inline void SlotSubmit(size_t& index)
+  {
+    const bool pushed = m_readyBuffers.TryPush(index);
+    assert(pushed);
+    index = m_buffers.size();
+  }
+  
+  inline void FillLoop()
+  {
+    const uint64_t splitGapNs = m_config.topSpeed ? UINT64_MAX :
+      static_cast<uint64_t>(static_cast<double>(m_config.splitGapNs) * m_config.speed);
+    size_t current = m_buffers.size();
+    uint64_t loopBaseNs = 0;
+    uint64_t lastNs = 0;
+    for(uint32_t loop = 0; !m_stopping && (!m_config.loops || loop < m_config.loops); ++loop)
+    {
+      uint64_t firstNs = 0;
+      uint64_t offsetNs = 0;
+      bool first = true;
+      const size_t visited = m_file.ForEach([&](const BRAWcapFilePacket& packet)
+      {
+        if(!packet.PayloadLength() || packet.PayloadLength() > m_config.maxPacketPayloadSize)
+        {
+          m_packetsSkipped.fetch_add(1, std::memory_order_relaxed);
+          return !m_stopping;
+        }
+        
+        // Out of order timestamps are sent back to back instead of waiting for a negative gap.
+        if(first)
+          firstNs = packet.TimestampTotalNs();
+        offsetNs = std::max(offsetNs, packet.TimestampTotalNs() > firstNs ? packet.TimestampTotalNs() - firstNs : 0);
+        const uint64_t recordedNs = loopBaseNs + offsetNs;
+        
+        if(current != m_buffers.size() && (m_buffers[current].packets == m_config.packetsPerBuffer ||
+          recordedNs - lastNs > splitGapNs))
+          SlotSubmit(current);
+        if(current == m_buffers.size())
+        {
+          if(!SlotAcquire(current))
+            return false;
+          m_buffers[current].dueNs = Scale(recordedNs);
+          m_buffers[current].packets = 0;
+          m_buffers[current].bytes = 0;
+        }
+        
+        const uint64_t scaledNs = Scale(recordedNs);
+        m_packet.PayloadSet(packet.Payload(), static_cast<brawcap_packet_size_t>(packet.PayloadLength()));
+        m_packet.TimestampNsSet(scaledNs / 1000000000, static_cast<uint32_t>(scaledNs % 1000000000));
+        const bool pushed = m_buffers[current].buffer.PushBack(m_packet);
+        assert(pushed);
+        ++m_buffers[current].packets;
+        m_buffers[current].bytes += packet.PayloadLength();
+        lastNs = recordedNs;
+        first = false;
+        return !m_stopping;
+      });
+      
+      if(!visited || m_stopping)
+        break;
+      m_loopsCompleted.fetch_add(1, std::memory_order_relaxed);
+      loopBaseNs += offsetNs;
+    }
+    
+    if(current != m_buffers.size())
+    {
+      if(m_buffers[current].packets && !m_stopping)
+        SlotSubmit(current);
+      else
+      {
+        m_buffers[current].buffer.Clear();
+        m_freeBuffers.TryPush(current);
+      }
+    }
+    m_fillDone.store(true, std::memory_order_release);
+  }
+  
+  inline void PaceLoop()
+  {
+    bool started = false;
+    uint64_t startNs = 0;
+    uint32_t idleRounds = 0;
+    while(!m_stopping)
+    {
+      size_t index = 0;
+      if(!m_readyBuffers.TryPop(index))
+      {
+        // Check again after seeing the fill thread done, it may have submitted its last buffer in between.
+        if(m_fillDone.load(std::memory_order_acquire))
+        {
+          if(!m_readyBuffers.TryPop(index))
+            break;
+        }
+        else
+        {
+          if(started && !idleRounds)
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+          Backoff(idleRounds);
+          continue;
+        }
+      }
+      idleRounds = 0;
+      
+      Slot& slot = m_buffers[index];
+      if(!started)
+      {
+        startNs = m_pClock->NowNs() - slot.dueNs;
+        started = true;
+      }
+      
+      uint64_t errorNs = 0;
+      if(!m_config.topSpeed)
+      {
+        const uint64_t deadlineNs = startNs + slot.dueNs;
+        m_pClock->SleepUntilNs(deadlineNs);
+        errorNs = m_pClock->NowNs() - deadlineNs;
+      }
+      
+      // Counted before the send, the completion may arrive before it returns. Rejected buffers never complete.
+      m_inFlight.fetch_add(1, std::memory_order_acq_rel);
+      if(!m_transmit.TransmitBufferSend(slot.buffer, !m_config.topSpeed))
+      {
+        m_transmitErrors.fetch_add(1, std::memory_order_relaxed);
+        slot.buffer.Clear();
+        m_freeBuffers.TryPush(index);
+        m_inFlight.fetch_sub(1, std::memory_order_acq_rel);
+      }
+      else
+      {
+        m_packetsSent.fetch_add(slot.packets, std::memory_order_relaxed);
+        m_bytesSent.fetch_add(slot.bytes, std::memory_order_relaxed);
+        m_buffersSent.fetch_add(1, std::memory_order_relaxed);
+      }
+      m_errorSumNs.fetch_add(errorNs, std::memory_order_relaxed);
+      m_errorHistogram[ErrorBucket(errorNs)].fetch_add(1, std::memory_order_relaxed);
+      if(errorNs > m_errorMaxNs.load(std::memory_order_relaxed))
+        m_errorMaxNs.store(errorNs, std::memory_order_relaxed);
+    }
+    
+    // Let the driver drain, buffers are only reusable once completed.
+    idleRounds = 0;
+    while(!m_stopping && m_inFlight.load(std::memory_order_acquire))
+      Backoff(idleRounds);
+    m_finished = !m_stopping;
+  }
+  
+  inline uint64_t Scale(const uint64_t recordedNs) const
+  {
+    return m_config.topSpeed ? 0 : static_cast<uint64_t>(static_cast<double>(recordedNs) / m_config.speed);
+  }
+  
+  inline static void TransmitBufferComplete(BRAWcapBuffer& buffer, brawcap_status_t status, void* pUser)
+  {
+    BRAWcapReplay* pReplay = reinterpret_cast<BRAWcapReplay*>(pUser);
+    const size_t index = pReplay->m_slotOfBuffer.at(buffer.m_pBuffer.get());
+    if(!BRAWCAP_SUCCESS(status))
+      pReplay->m_transmitErrors.fetch_add(1, std::memory_order_relaxed);
+    
+    pReplay->m_buffers[index].buffer.Clear();
+    pReplay->m_freeBuffers.TryPush(index);
+    pReplay->m_inFlight.fetch_sub(1, std::memory_order_acq_rel);
+  }
+  
+private:
+  BRAWcapTransmit& m_transmit;
+  Config m_config;
+  BRAWcapClock* m_pClock;
+  std::unique_ptr<BRAWcapClock> m_pOwnClock;
+  BRAWcapFileReader m_file;
+  BRAWcapPacket m_packet;
+  std::vector<Slot> m_buffers;
+  BRAWcapRing<size_t> m_freeBuffers;
+  BRAWcapRing<size_t> m_readyBuffers;
+  std::unordered_map<const brawcap_buffer_t*, size_t> m_slotOfBuffer; // built once, read by completions
+  std::atomic<size_t> m_inFlight;
+  std::thread m_fillThread;
+  std::thread m_paceThread;
+  std::atomic<bool> m_running;
+  std::atomic<bool> m_stopping;
+  std::atomic<bool> m_fillDone;
+  std::atomic<bool> m_finished;
+  
+  std::atomic<uint64_t> m_packetsSent;
+  std::atomic<uint64_t> m_bytesSent;
+  std::atomic<uint64_t> m_buffersSent;
+  std::atomic<uint64_t> m_packetsSkipped;
+  std::atomic<uint64_t> m_loopsCompleted;
+  std::atomic<uint64_t> m_underruns;
+  std::atomic<uint64_t> m_transmitErrors;
+  std::atomic<uint64_t> m_errorMaxNs;
+  std::atomic<uint64_t> m_errorSumNs;
+  std::atomic<uint64_t> m_errorHistogram[ERROR_BUCKETS];
+};
+
+#endif // BRAWCAP_REPLAY_HPP
@@ -0,0 +1,144 @@
+/**
+ * @file brawcap_ring.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Ring (bounded lock-free MPMC queue).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_RING_HPP
+#define BRAWCAP_RING_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
+// CPP
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#endif // INCLUDES
+
+template<typename T>
+class BRAWcapRing
+{
+  static_assert(std::is_trivially_copyable<T>::value, "BRAWcapRing only transports trivially copyable values.");
+  
+public:
+  inline BRAWcapRing(const size_t capacity)
+    : m_capacity(2), m_head(0), m_tail(0)
+  {
+    assert(capacity);
+    while(m_capacity < capacity)
+      m_capacity <<= 1;
+    m_mask = m_capacity - 1;
+    
+    m_cells = std::unique_ptr<Cell[]>(new Cell[m_capacity]);
+    for(size_t index = 0; index < m_capacity; ++index)
+      m_cells[index].sequence.store(index, std::memory_order_relaxed);
+  }
+  
+  inline ~BRAWcapRing()
+  { }
+  
+  BRAWcapRing(const BRAWcapRing&) = delete;
+  BRAWcapRing& operator=(const BRAWcapRing&) = delete;
+  
+  inline bool TryPush(const T& value)
+  {
+    size_t position = m_tail.load(std::memory_order_relaxed);
+    for(;;)
+    {
+      Cell& cell = m_cells[position & m_mask];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if(!diff)
+      {
+        if(m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        {
+          cell.value = value;
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      }
+      else if(diff < 0)
+        return false;
+      else
+        position = m_tail.load(std::memory_order_relaxed);
+    }
+  }
+  
+  inline bool TryPop(T& value)
+  {
+    size_t position = m_head.load(std::memory_order_relaxed);
+    for(;;)
+    {
+      Cell& cell = m_cells[position & m_mask];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+      if(!diff)
+      {
+        if(m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        {
+          value = cell.value;
+          cell.sequence.store(position + m_capacity, std::memory_order_release);
+          return true;
+        }
+      }
+      else if(diff < 0)
+        return false;
+      else
+        position = m_head.load(std::memory_order_relaxed);
+    }
+  }
+  
+  inline size_t Size() const
+  {
+    const size_t tail = m_tail.load(std::memory_order_acquire);
+    const size_t head = m_head.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
+  }
+  
+  inline bool Empty() const
+  {
+    return !Size();
+  }
+  
+  inline size_t Capacity() const
+  {
+    return m_capacity;
+  }
+  
+private:
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+  
+private:
+  size_t m_capacity;
+  size_t m_mask;
+  std::unique_ptr<Cell[]> m_cells;
+  
+  alignas(64) std::atomic<size_t> m_head;
+  alignas(64) std::atomic<size_t> m_tail;
+};
+
+#endif // BRAWCAP_RING_HPP
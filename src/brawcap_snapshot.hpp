@@ -0,0 +1,426 @@
+/**
+ * @file brawcap_snapshot.hpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Snapshot (circular in-memory capture with triggered dump).
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#ifndef BRAWCAP_SNAPSHOT_HPP
+#define BRAWCAP_SNAPSHOT_HPP
+
+#if 1 // INCLUDES
+// STD
+// C
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cassert>
+// CPP
+#include <string>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+
+// bRAWcap
+#include "libbrawcap.h"
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet_view.hpp"
+#include "brawcap_file_packet.hpp"
+#include "brawcap_pcap_writer.hpp"
+#endif // INCLUDES
+
+// Keeps the most recent traffic in a preallocated byte ring and writes the window around a trigger to a pcap file.
+// The capture side always overwrites the oldest data; if the snapshot writer is overtaken, the lost range is skipped
+// and the snapshot is marked as truncated instead of throttling the capture.
+class BRAWcapSnapshot
+{
+public:
+  typedef bool(*TriggerPredicate)(const BRAWcapPacketView& packet, void* pUser);
+  
+  struct Config
+  {
+    std::string pathPrefix;
+    uint64_t capacityBytes = 1024ULL * 1024 * 1024;
+    uint32_t retentionMs = 0; // 0: limited by capacity only
+    uint32_t preTriggerMs = 5000;
+    uint32_t postTriggerMs = 1000;
+    uint32_t snapLength = BRAWCAP_PACKET_SIZE_MAX; // bytes stored per packet, see BRAWcapFilter::CaptureSnapLength()
+  };
+  
+  struct SnapshotInfo
+  {
+    std::string path;
+    uint64_t triggerNs;
+    uint64_t packets;
+    uint64_t bytesLost;
+    bool truncated;
+  };
+  
+  struct Stats
+  {
+    uint64_t packetsStored;
+    uint64_t bytesStored;
+    uint64_t bytesUsed;
+    uint64_t triggers;
+    uint64_t triggersIgnored;
+    uint64_t snapshots;
+    uint64_t snapshotsTruncated;
+  };
+  
+public:
+  inline BRAWcapSnapshot(const Config& config)
+    : m_config(config), m_capacity((config.capacityBytes + 7) & ~7ULL), m_pRing(new char[m_capacity]), m_head(0),
+      m_tail(0), m_newestNs(0), m_predicate(nullptr), m_pPredicateUser(nullptr), m_triggerPending(false),
+      m_triggerNs(0), m_snapshotIndex(0), m_running(false), m_stopping(false), m_packetsStored(0),
+      m_bytesStored(0), m_triggers(0), m_triggersIgnored(0), m_snapshots(0), m_snapshotsTruncated(0)
+  {
+    assert(!m_config.pathPrefix.empty());
+    m_config.snapLength = std::min<uint32_t>(m_config.snapLength, BRAWCAP_PACKET_SIZE_MAX);
+    assert(m_config.snapLength && m_capacity >= 4 * RecordSize(m_config.snapLength));
+    // Fault in all pages now, not while capturing.
+    memset(m_pRing.get(), 0, m_capacity);
+  }
+  
+  inline ~BRAWcapSnapshot()
+  {
+    if(m_running)
+      Stop();
+  }
+  
+  BRAWcapSnapshot(const BRAWcapSnapshot&) = delete;
+  BRAWcapSnapshot& operator=(const BRAWcapSnapshot&) = delete;
+  
+  inline void Start()
+  {
+    assert(!m_running);
+    m_stopping = false;
+    m_running = true;
+    m_writer = std::thread(&BRAWcapSnapshot::WriterLoop, this);
+  }
+  
+  // Completes a pending snapshot with the data captured so far.
+  inline void Stop()
+  {
+    assert(m_running);
+    {
+      std::lock_guard<std::mutex> localLock(m_triggerLock);
+      m_stopping = true;
+    }
+    m_triggerWakeup.notify_all();
+    m_writer.join();
+    m_running = false;
+  }
+  
+  // The predicate is evaluated for every stored packet while no snapshot is pending.
+  inline void TriggerPredicateSet(TriggerPredicate predicate, void* pUser)
+  {
+    std::lock_guard<std::mutex> localLock(m_captureLock);
+    m_predicate = predicate;
+    m_pPredicateUser = pUser;
+  }
+  
+  // Triggers a snapshot around the newest stored packet. Returns false if a snapshot is still in progress.
+  inline bool Trigger()
+  {
+    return TriggerAt(m_newestNs.load(std::memory_order_relaxed));
+  }
+  
+  // Triggers a snapshot around the given timestamp, in the timestamp domain of the captured packets.
+  inline bool TriggerAt(const uint64_t timestampNs)
+  {
+    m_triggers.fetch_add(1, std::memory_order_relaxed);
+    {
+      // Pending and the timestamp change together, the writer must never see one without the other.
+      std::lock_guard<std::mutex> localLock(m_triggerLock);
+      bool expected = false;
+      if(!m_triggerPending.compare_exchange_strong(expected, true))
+      {
+        m_triggersIgnored.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+      m_triggerNs = timestampNs;
+    }
+    m_triggerWakeup.notify_one();
+    return true;
+  }
+  
+  inline bool SnapshotPending() const
+  {
+    return m_triggerPending;
+  }
+  
+  inline bool LastSnapshot(SnapshotInfo& info) const
+  {
+    std::lock_guard<std::mutex> localLock(m_triggerLock);
+    info = m_lastSnapshot;
+    return !info.path.empty();
+  }
+  
+  inline std::string FileName(const uint32_t snapshotIndex) const
+  {
+    char suffix[24] = { '\0' };
+    snprintf(suffix, sizeof(suffix), "_snapshot_%05u.pcap", snapshotIndex);
+    return m_config.pathPrefix + suffix;
+  }
+  
+  // Stores all packets of the buffer, may be called from parallel receive callbacks.
+  inline void Write(BRAWcapBuffer& buffer)
+  {
+    std::lock_guard<std::mutex> localLock(m_captureLock);
+    buffer.ForEach([this](const BRAWcapPacketView& packet)
+    {
+      Store(packet);
+    });
+  }
+  
+  // Receive callback for BRAWcapReceive::ReceiveStart(), pass the snapshot as user pointer.
+  inline static void ReceiveBufferComplete(BRAWcapBuffer& buffer, brawcap_status_t status, void* pUser)
+  {
+    if(BRAWCAP_SUCCESS(status))
+      reinterpret_cast<BRAWcapSnapshot*>(pUser)->Write(buffer);
+  }
+  
+  inline void Statistics(Stats& stats) const
+  {
+    stats.packetsStored = m_packetsStored.load(std::memory_order_relaxed);
+    stats.bytesStored = m_bytesStored.load(std::memory_order_relaxed);
+    stats.bytesUsed = m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_relaxed);
+    stats.triggers = m_triggers.load(std::memory_order_relaxed);
+    stats.triggersIgnored = m_triggersIgnored.load(std::memory_order_relaxed);
+    stats.snapshots = m_snapshots.load(std::memory_order_relaxed);
+    stats.snapshotsTruncated = m_snapshotsTruncated.load(std::memory_order_relaxed);
+  }
+  
+private:
+  static constexpr uint32_t LENGTH_WRAP = UINT32_MAX;
+  
+  struct RecordHeader
+  {
+    uint64_t timestampNs;
+    uint32_t length;
+    uint32_t lengthOnWire;
+  };
+  
+private:
+  inline static uint64_t RecordSize(const uint32_t length)
+  {
+    return (sizeof(RecordHeader) + length + 7) & ~7ULL;
+  }
+  
+  // Returns the position of the record following the one at position. Ring positions increase monotonic, the
+  // offset inside the ring is position % capacity.
+  inline uint64_t RecordNext(const uint64_t position, RecordHeader& header, bool& isRecord) const
+  {
+    const uint64_t offset = position % m_capacity;
+    const uint64_t room = m_capacity - offset;
+    isRecord = false;
+    if(room < sizeof(RecordHeader))
+      return position + room;
+    memcpy(&header, m_pRing.get() + offset, sizeof(header));
+    if(header.length == LENGTH_WRAP)
+      return position + room;
+    isRecord = true;
+    return position + RecordSize(header.length);
+  }
+  
+  // Capture side, called with m_captureLock held.
+  inline void Store(const BRAWcapPacketView& packet)
+  {
+    uint64_t seconds = 0;
+    uint32_t nanoseconds = 0;
+    packet.TimestampNs(seconds, nanoseconds);
+    
+    RecordHeader header;
+    header.timestampNs = seconds * 1000000000ULL + nanoseconds;
+    header.length = std::min<uint32_t>(packet.PayloadLength(), m_config.snapLength);
+    header.lengthOnWire = packet.LengthOnWire();
+    
+    const uint64_t size = RecordSize(header.length);
+    uint64_t position = m_head.load(std::memory_order_relaxed);
+    const uint64_t room = m_capacity - position % m_capacity;
+    const uint64_t skip = room < size ? room : 0;
+    const uint64_t end = position + skip + size;
+    
+    // Publish the eviction before overwriting, the writer validates its reads against m_tail.
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    RecordHeader evicted;
+    bool isRecord = false;
+    while(tail + m_capacity < end)
+      tail = RecordNext(tail, evicted, isRecord);
+    if(m_config.retentionMs)
+    {
+      const uint64_t retentionNs = m_config.retentionMs * 1000000ULL;
+      while(tail < position)
+      {
+        const uint64_t next = RecordNext(tail, evicted, isRecord);
+        if(isRecord && evicted.timestampNs + retentionNs >= header.timestampNs)
+          break;
+        tail = next;
+      }
+    }
+    m_tail.store(tail, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    if(skip >= sizeof(RecordHeader))
+    {
+      RecordHeader wrap = {};
+      wrap.length = LENGTH_WRAP;
+      memcpy(m_pRing.get() + position % m_capacity, &wrap, sizeof(wrap));
+    }
+    position += skip;
+    char* pRecord = m_pRing.get() + position % m_capacity;
+    memcpy(pRecord, &header, sizeof(header));
+    memcpy(pRecord + sizeof(header), packet.Payload(), header.length);
+    m_head.store(end, std::memory_order_release);
+    
+    m_newestNs.store(header.timestampNs, std::memory_order_relaxed);
+    m_packetsStored.fetch_add(1, std::memory_order_relaxed);
+    m_bytesStored.fetch_add(header.length, std::memory_order_relaxed);
+    
+    if(m_predicate && !m_triggerPending.load(std::memory_order_relaxed) && m_predicate(packet, m_pPredicateUser))
+      TriggerAt(header.timestampNs);
+  }
+  
+  // Writer side
+  
+  inline void WriterLoop()
+  {
+    std::unique_ptr<char[]> pScratch(new char[m_config.snapLength]);
+    for(;;)
+    {
+      uint64_t triggerNs = 0;
+      {
+        std::unique_lock<std::mutex> localLock(m_triggerLock);
+        m_triggerWakeup.wait(localLock, [this]()
+        {
+          return m_stopping || m_triggerPending;
+        });
+        if(!m_triggerPending)
+          break;
+        triggerNs = m_triggerNs;
+      }
+      
+      SnapshotInfo info = SnapshotWrite(triggerNs, pScratch.get());
+      m_snapshots.fetch_add(1, std::memory_order_relaxed);
+      if(info.truncated)
+        m_snapshotsTruncated.fetch_add(1, std::memory_order_relaxed);
+      {
+        std::lock_guard<std::mutex> localLock(m_triggerLock);
+        m_lastSnapshot = info;
+        m_triggerPending = false;
+      }
+    }
+  }
+  
+  inline SnapshotInfo SnapshotWrite(const uint64_t triggerNs, char* pScratch)
+  {
+    SnapshotInfo info = {};
+    info.path = FileName(m_snapshotIndex++);
+    info.triggerNs = triggerNs;
+    
+    BRAWcapPcapWriter writer;
+    if(!writer.Open(info.path, m_config.snapLength))
+      return info;
+    
+    const uint64_t preNs = m_config.preTriggerMs * 1000000ULL;
+    const uint64_t startNs = triggerNs > preNs ? triggerNs - preNs : 0;
+    const uint64_t endNs = triggerNs + m_config.postTriggerMs * 1000000ULL;
+    // Without traffic the packet clock stands still, give up some time after the post trigger window.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(m_config.postTriggerMs) +
+      std::chrono::seconds(1);
+    
+    uint64_t position = m_tail.load(std::memory_order_acquire);
+    for(;;)
+    {
+      if(position >= m_head.load(std::memory_order_acquire))
+      {
+        if(m_stopping || std::chrono::steady_clock::now() > deadline)
+          break;
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        continue;
+      }
+      
+      const uint64_t tail = m_tail.load(std::memory_order_acquire);
+      if(position < tail)
+      {
+        info.truncated = true;
+        info.bytesLost += tail - position;
+        position = tail;
+        continue;
+      }
+      
+      RecordHeader header;
+      bool isRecord = false;
+      const uint64_t next = RecordNext(position, header, isRecord);
+      const uint64_t offset = position % m_capacity;
+      if(isRecord && header.length <= m_config.snapLength && offset + RecordSize(header.length) <= m_capacity)
+        memcpy(pScratch, m_pRing.get() + offset + sizeof(header), header.length);
+      
+      // The capture side may have overwritten the record while copying, only trust it if it is still retained.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(m_tail.load(std::memory_order_relaxed) > position)
+        continue;
+      
+      position = next;
+      if(!isRecord || header.timestampNs < startNs)
+        continue;
+      if(header.timestampNs > endNs)
+        break;
+      
+      writer.Write(BRAWcapFilePacket(pScratch, header.length, header.lengthOnWire, header.timestampNs, 1, 0, 0));
+      ++info.packets;
+    }
+    
+    writer.Close();
+    return info;
+  }
+  
+private:
+  Config m_config;
+  uint64_t m_capacity;
+  std::unique_ptr<char[]> m_pRing;
+  std::atomic<uint64_t> m_head;
+  std::atomic<uint64_t> m_tail;
+  std::atomic<uint64_t> m_newestNs;
+  std::mutex m_captureLock;
+  TriggerPredicate m_predicate;
+  void* m_pPredicateUser;
+  
+  mutable std::mutex m_triggerLock;
+  std::condition_variable m_triggerWakeup;
+  std::atomic<bool> m_triggerPending;
+  uint64_t m_triggerNs;
+  uint32_t m_snapshotIndex;
+  SnapshotInfo m_lastSnapshot;
+  std::atomic<bool> m_running;
+  std::atomic<bool> m_stopping;
+  std::thread m_writer;
+  
+  std::atomic<uint64_t> m_packetsStored;
+  std::atomic<uint64_t> m_bytesStored;
+  std::atomic<uint64_t> m_triggers;
+  std::atomic<uint64_t> m_triggersIgnored;
+  std::atomic<uint64_t> m_snapshots;
+  std::atomic<uint64_t> m_snapshotsTruncated;
+};
+
+#endif // BRAWCAP_SNAPSHOT_HPP
@@ -28,27 +28,49 @@
 // C
 #include <cstdbool>
 #include <cassert>
+#include <cstdint>
 // CPP
+#include <unordered_map>
 #include <vector>
+#include <memory>
+#include <atomic>
 #include <mutex>
 
 // bRAWcap
 #include "brawcap_handle.hpp"
 #include "brawcap_adapter.hpp"
 #include "brawcap_buffer.hpp"
+#include "brawcap_buffer_pool.hpp"
 #endif // INCLUDES
 
 class BRAWcapTransmit : virtual public BRAWcapAdapter, virtual public BRAWcapHandle
 {
   using TransmitBufferCompleteCallback = void(*)(BRAWcapBuffer& buffer, brawcap_status_t status, void* pUser);
-
+  
+public:
+  struct PoolStats
+  {
+    uint64_t buffersSent;
+    uint64_t buffersRecycled;
+    uint64_t acquireFailures; // pool was empty, all buffers in flight
+    uint64_t bufferAllocations; // native buffers created for the pool
+    uint64_t trackingAllocations; // in flight bookkeeping nodes, stops growing once the in flight count is reached
+    size_t buffersTotal;
+    size_t buffersFree;
+    size_t buffersInUseMax;
+  };
+  
 public:
   inline BRAWcapTransmit(const std::string& name)
-    : BRAWcapHandle(name), BRAWcapAdapter(name)
+    : BRAWcapHandle(name), BRAWcapAdapter(name), m_buffersPending(0), m_trackingAllocations(0),
+      m_poolBuffersSent(0), m_poolBuffersRecycled(0), m_callback(nullptr), m_pUser(nullptr)
   { }
   
   inline ~BRAWcapTransmit()
-  { }
+  {
+    if(m_pPool)
+      TransmitBufferPoolDestroy();
+  }
   
   inline bool TransmitSinglePacket(const BRAWcapPacket& packet)
   {
@@ -57,9 +79,10 @@ public:
     return BRAWCAP_SUCCESS(status) || BRAWCAP_INFO(status);
   }
   
+  // The callback is optional with a buffer pool, pooled buffers are recycled after it returned.
   inline bool TransmitStart(TransmitBufferCompleteCallback callback, void* pUser)
   {
-    assert(callback);
+    assert(callback || m_pPool);
     m_callback = callback;
     m_pUser = pUser;
     brawcap_status_t status = brawcap_tx_start(BRAWcapHandle::Native().get(), TransmitBufferCompleteInternal, this);
@@ -76,14 +99,81 @@ public:
   
   inline bool TransmitBufferSend(BRAWcapBuffer& buffer, const bool synchronized)
   {
-    m_bufferLock.lock();
-    m_buffers.push_back(buffer);
-    m_bufferLock.unlock();
-    brawcap_status_t status = brawcap_tx_buffer_send(BRAWcapHandle::Native().get(), buffer.m_pBuffer.get(), synchronized);
+    brawcap_buffer_t* const pBuffer = buffer.m_pBuffer.get();
+    const bool inserted = TransmitBufferTrack(buffer) != nullptr;
+    
+    brawcap_status_t status = brawcap_tx_buffer_send(BRAWcapHandle::Native().get(), pBuffer, synchronized);
     assert(!BRAWCAP_ERROR(status));
+    // Rejected buffers never complete, pooled ones go straight back to the pool. If the buffer was already in
+    // flight the entry belongs to that send.
+    if(BRAWCAP_ERROR(status) && inserted)
+    {
+      TransmitBufferRecycle(TransmitBufferTake(pBuffer));
+      if(m_pPool && m_poolBuffers.count(pBuffer))
+        m_pPool->Release(m_poolBuffers.at(pBuffer));
+      m_buffersPending.fetch_sub(1, std::memory_order_release);
+    }
+    else if(m_pPool && m_poolBuffers.count(pBuffer))
+      m_poolBuffersSent.fetch_add(1, std::memory_order_relaxed);
     return BRAWCAP_SUCCESS(status) || BRAWCAP_INFO(status);
   }
   
+  // Buffers handed to the driver whose completion has not finished yet (callback run, pooled buffer released).
+  inline size_t TransmitBuffersPending() const
+  {
+    return m_buffersPending.load(std::memory_order_acquire);
+  }
+  
+  // Preallocates numBuffers transmit buffers. Acquired buffers are sent with TransmitBufferSend() as usual and
+  // return to the pool cleared on completion, so steady state transmission does not allocate.
+  inline void TransmitBufferPoolCreate(const brawcap_packet_size_t maxPacketPayloadSize,
+    const brawcap_buffer_packet_count_t numPackets, const size_t numBuffers)
+  {
+    assert(!m_pPool);
+    m_pPool = std::make_unique<BRAWcapBufferPool>(maxPacketPayloadSize, numPackets, numBuffers);
+    m_poolBuffersSent = 0;
+    m_poolBuffersRecycled = 0;
+    
+    // Read only while the pool exists, completions look up their pool buffer without locking.
+    m_poolBuffers.reserve(numBuffers);
+    for(size_t index = 0; index < m_pPool->Size(); ++index)
+      m_poolBuffers.emplace(m_pPool->At(index)->m_pBuffer.get(), m_pPool->At(index));
+  }
+  
+  // All pooled buffers must have completed.
+  inline void TransmitBufferPoolDestroy()
+  {
+    assert(m_pPool && m_pPool->Available() == m_pPool->Size());
+    m_poolBuffers.clear();
+    m_pPool.reset();
+  }
+  
+  // Returns an empty pooled buffer or nullptr if all of them are in flight.
+  inline BRAWcapBuffer* TransmitBufferAcquire()
+  {
+    assert(m_pPool);
+    return m_pPool->Acquire();
+  }
+  
+  // Returns an acquired buffer which is not going to be sent.
+  inline void TransmitBufferRelease(BRAWcapBuffer* pBuffer)
+  {
+    assert(m_pPool);
+    m_pPool->Release(pBuffer);
+  }
+  
+  inline void TransmitBufferPoolStatistics(PoolStats& stats) const
+  {
+    stats.buffersSent = m_poolBuffersSent.load(std::memory_order_relaxed);
+    stats.buffersRecycled = m_poolBuffersRecycled.load(std::memory_order_relaxed);
+    stats.acquireFailures = m_pPool ? m_pPool->AcquireFailures() : 0;
+    stats.bufferAllocations = m_pPool ? m_pPool->Size() : 0;
+    stats.trackingAllocations = m_trackingAllocations.load(std::memory_order_relaxed);
+    stats.buffersTotal = m_pPool ? m_pPool->Size() : 0;
+    stats.buffersFree = m_pPool ? m_pPool->Available() : 0;
+    stats.buffersInUseMax = m_pPool ? m_pPool->InUseMax() : 0;
+  }
+  
   inline void TransmitDriverQueueSizeSet(const brawcap_queue_size_t size)
   {
     brawcap_status_t status = brawcap_tx_driver_queue_size_set(BRAWcapHandle::Native().get(), size);
@@ -121,28 +211,115 @@ public:
   }
   
 private:
+  static constexpr size_t SHARD_BITS = 4;
+  static constexpr size_t SHARD_COUNT = 1 << SHARD_BITS;
+  
+  using BufferMap = std::unordered_map<brawcap_buffer_t*, BRAWcapBuffer>;
+  
+  // In flight buffers are spread over independently locked hash maps, so completions and concurrent senders rarely
+  // meet on the same lock and a lookup does not depend on the number of buffers in flight. Completed map nodes are
+  // kept as spares, steady state sending does not allocate.
+  struct alignas(64) Shard
+  {
+    std::mutex lock;
+    BufferMap buffers;
+    std::vector<BufferMap::node_type> spares;
+  };
+  
+protected:
+  // The buffer is referenced until its completion, keyed by the native buffer for the completion lookup. Returns
+  // that native buffer, nullptr if the buffer is already in flight. Protected like the completion below, so derived
+  // classes can drive the in-flight bookkeeping without the driver.
+  inline brawcap_buffer_t* TransmitBufferTrack(BRAWcapBuffer& buffer)
+  {
+    brawcap_buffer_t* const pBuffer = buffer.m_pBuffer.get();
+    Shard& shard = ShardOf(pBuffer);
+    bool inserted = false;
+    {
+      std::lock_guard<std::mutex> localLock(shard.lock);
+      if(shard.spares.empty())
+      {
+        inserted = shard.buffers.emplace(pBuffer, buffer).second;
+        if(inserted)
+          m_trackingAllocations.fetch_add(1, std::memory_order_relaxed);
+      }
+      else if(!shard.buffers.count(pBuffer))
+      {
+        BufferMap::node_type node = std::move(shard.spares.back());
+        shard.spares.pop_back();
+        node.key() = pBuffer;
+        node.mapped() = buffer;
+        inserted = shard.buffers.insert(std::move(node)).inserted;
+      }
+    }
+    if(!inserted)
+      return nullptr;
+    m_buffersPending.fetch_add(1, std::memory_order_relaxed);
+    return pBuffer;
+  }
+  
   inline static void TransmitBufferCompleteInternal(brawcap_handle_t* const pHandle, const brawcap_status_t status,
     brawcap_buffer_t* const pBuffer, void* pUser)
   {
     BRAWcapTransmit* pTransmit = reinterpret_cast<BRAWcapTransmit*>(pUser);
-    pTransmit->m_bufferLock.lock();
-    for(std::vector<BRAWcapBuffer>::iterator it = pTransmit->m_buffers.begin(); it != pTransmit->m_buffers.end(); ++it)
+    BufferMap::node_type node = pTransmit->TransmitBufferTake(pBuffer);
+    if(!node)
+      return;
+    if(pTransmit->m_callback)
+      pTransmit->m_callback(node.mapped(), status, pTransmit->m_pUser);
+    pTransmit->TransmitBufferRecycle(std::move(node));
+    
+    if(pTransmit->m_pPool)
     {
-      if(it->m_pBuffer.get() == pBuffer)
+      auto pooled = pTransmit->m_poolBuffers.find(pBuffer);
+      if(pooled != pTransmit->m_poolBuffers.end())
       {
-        BRAWcapBuffer buffer = *it;
-        pTransmit->m_buffers.erase(it);
-        pTransmit->m_bufferLock.unlock();
-        pTransmit->m_callback(buffer, status, pTransmit->m_pUser);
-        return;
+        pTransmit->m_pPool->Release(pooled->second);
+        pTransmit->m_poolBuffersRecycled.fetch_add(1, std::memory_order_relaxed);
       }
     }
-    pTransmit->m_bufferLock.unlock();
+    // Last, waiters on TransmitBuffersPending() may destroy the pool right after.
+    pTransmit->m_buffersPending.fetch_sub(1, std::memory_order_release);
+  }
+  
+private:
+  inline Shard& ShardOf(const brawcap_buffer_t* const pBuffer)
+  {
+    // Buffers are heap allocations, drop the alignment bits before spreading.
+    const uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pBuffer) >> 4);
+    return m_shards[(key * 0x9E3779B97F4A7C15ULL) >> (64 - SHARD_BITS)];
+  }
+  
+  inline BufferMap::node_type TransmitBufferTake(brawcap_buffer_t* const pBuffer)
+  {
+    Shard& shard = ShardOf(pBuffer);
+    BufferMap::node_type node;
+    {
+      std::lock_guard<std::mutex> localLock(shard.lock);
+      node = shard.buffers.extract(pBuffer);
+    }
+    return node;
+  }
+  
+  // Drops the buffer reference, a spare must not keep a completed buffer alive.
+  inline void TransmitBufferRecycle(BufferMap::node_type&& node)
+  {
+    if(!node)
+      return;
+    Shard& shard = ShardOf(node.key());
+    node.mapped().m_pBuffer.reset();
+    std::lock_guard<std::mutex> localLock(shard.lock);
+    shard.spares.push_back(std::move(node));
   }
   
 private:
-  std::mutex m_bufferLock;
-  std::vector<BRAWcapBuffer> m_buffers;
+  Shard m_shards[SHARD_COUNT];
+  std::atomic<size_t> m_buffersPending;
+  std::atomic<uint64_t> m_trackingAllocations;
+  std::unique_ptr<BRAWcapBufferPool> m_pPool;
+  std::unordered_map<brawcap_buffer_t*, BRAWcapBuffer*> m_poolBuffers;
+  std::atomic<uint64_t> m_poolBuffersSent;
+  std::atomic<uint64_t> m_poolBuffersRecycled;
   TransmitBufferCompleteCallback m_callback;
   void* m_pUser;
 };
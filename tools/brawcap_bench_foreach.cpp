@@ -0,0 +1,173 @@
+/**
+ * @file brawcap_bench_foreach.cpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Benchmark - buffer walk with Iterator and ForEach.
+ *
+ *
+ * Usage:
+ *   brawcap_bench_foreach [-p packets per buffer] [-s payload bytes] [-n walks]
+ *
+ * Fills one buffer and walks it repeatedly with the legacy BRAWcapBuffer::Iterator and with ForEach(), reading the
+ * payload only and the payload plus the timestamp. Reports nanoseconds per packet. No adapter is needed.
+ *
+ * Build (MSVC, from the repository root):
+ *   cl /std:c++17 /O2 /EHsc /Isrc /Isdk\c\include tools\brawcap_bench_foreach.cpp sdk\c\lib\libbrawcap64.lib
+ *
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// STD
+// C
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+// CPP
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+// bRAWcap
+#include "brawcap_buffer.hpp"
+#include "brawcap_packet.hpp"
+#include "brawcap_packet_view.hpp"
+
+struct Options
+{
+  brawcap_buffer_packet_count_t packets = 4096;
+  brawcap_packet_size_t payloadSize = 64;
+  uint64_t walks = 2000;
+};
+
+// Keeps the walks from being optimized away.
+static volatile uint64_t g_sink = 0;
+
+static void Usage()
+{
+  printf("Usage:\n");
+  printf("  brawcap_bench_foreach [-p packets per buffer] [-s payload bytes] [-n walks]\n");
+}
+
+static bool ParseArgs(int argc, char** argv, Options& options)
+{
+  for(int index = 1; index < argc; ++index)
+  {
+    const std::string arg = argv[index];
+    const bool hasValue = index + 1 < argc;
+    if(arg == "-p" && hasValue)
+      options.packets = static_cast<brawcap_buffer_packet_count_t>(strtoul(argv[++index], nullptr, 0));
+    else if(arg == "-s" && hasValue)
+      options.payloadSize = static_cast<brawcap_packet_size_t>(strtoul(argv[++index], nullptr, 0));
+    else if(arg == "-n" && hasValue)
+      options.walks = strtoull(argv[++index], nullptr, 0);
+    else
+      return false;
+  }
+  return options.packets && options.payloadSize && options.payloadSize <= BRAWCAP_PACKET_SIZE_MAX && options.walks;
+}
+
+// Nanoseconds per packet over all walks, after one walk to warm up the caches.
+template<typename Walk>
+static double Measure(const Options& options, Walk&& walk)
+{
+  g_sink = g_sink + walk();
+  const auto start = std::chrono::steady_clock::now();
+  uint64_t sum = 0;
+  for(uint64_t round = 0; round < options.walks; ++round)
+    sum += walk();
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  g_sink = g_sink + sum;
+  return seconds * 1e9 / (static_cast<double>(options.walks) * options.packets);
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if(!ParseArgs(argc, argv, options))
+  {
+    Usage();
+    return EXIT_FAILURE;
+  }
+  
+  BRAWcapBuffer buffer(options.payloadSize, options.packets);
+  BRAWcapPacket packet(options.payloadSize);
+  std::vector<char> payload(options.payloadSize, 0x5A);
+  for(brawcap_buffer_packet_count_t index = 0; index < options.packets; ++index)
+  {
+    packet.PayloadSet(payload.data(), options.payloadSize);
+    packet.TimestampNsSet(index, index);
+    if(!buffer.PushBack(packet))
+      break;
+  }
+  if(buffer.Count() != options.packets)
+  {
+    printf("[ERROR] Could not fill the buffer with %u packets.\n", options.packets);
+    return EXIT_FAILURE;
+  }
+  
+  const double iteratorPayload = Measure(options, [&buffer]()
+  {
+    uint64_t sum = 0;
+    const BRAWcapBuffer::Iterator end = buffer.End();
+    for(BRAWcapBuffer::Iterator it = buffer.Begin(); it != end; ++it)
+      sum += it->PayloadLength();
+    return sum;
+  });
+  const double forEachPayload = Measure(options, [&buffer]()
+  {
+    uint64_t sum = 0;
+    buffer.ForEach([&sum](const BRAWcapPacketView& view)
+    {
+      sum += view.PayloadLength();
+    });
+    return sum;
+  });
+  const double iteratorTimestamp = Measure(options, [&buffer]()
+  {
+    uint64_t sum = 0;
+    const BRAWcapBuffer::Iterator end = buffer.End();
+    for(BRAWcapBuffer::Iterator it = buffer.Begin(); it != end; ++it)
+    {
+      uint64_t seconds = 0;
+      uint32_t nanoseconds = 0;
+      it->TimestampNs(seconds, nanoseconds);
+      sum += it->PayloadLength() + nanoseconds;
+    }
+    return sum;
+  });
+  const double forEachTimestamp = Measure(options, [&buffer]()
+  {
+    uint64_t sum = 0;
+    buffer.ForEach([&sum](const BRAWcapPacketView& view)
+    {
+      uint64_t seconds = 0;
+      uint32_t nanoseconds = 0;
+      view.TimestampNs(seconds, nanoseconds);
+      sum += view.PayloadLength() + nanoseconds;
+    });
+    return sum;
+  });
+  
+  printf("%u packets of %u bytes, %llu walks\n", options.packets, options.payloadSize,
+    static_cast<unsigned long long>(options.walks));
+  printf("%-24s %12s %12s\n", "", "Iterator", "ForEach");
+  printf("%-24s %9.2f ns %9.2f ns\n", "payload", iteratorPayload, forEachPayload);
+  printf("%-24s %9.2f ns %9.2f ns\n", "payload and timestamp", iteratorTimestamp, forEachTimestamp);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+/**
+ * @file brawcap_bench_receive.cpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Benchmark - ReceiveStart callback against BRAWcapReceiveT.
+ *
+ *
+ * Usage:
+ *   brawcap_bench_receive -a adapter [-t seconds per path] [-b buffers] [-p packets per buffer]
+ *
+ * Receives live traffic on the adapter, first through ReceiveStart() with a function pointer callback, then through
+ * BRAWcapReceiveT with a handler type. Both do the same per packet work (ForEach over the buffer). The completion
+ * entry point of each path is timed from entry to return, reported in nanoseconds per packet and per buffer.
+ * Traffic has to be fed from outside (e.g. brawcap_generator on a link partner) at the same rate for both paths.
+ *
+ * Build (MSVC, from the repository root):
+ *   cl /std:c++17 /O2 /EHsc /Isrc /Isdk\c\include tools\brawcap_bench_receive.cpp sdk\c\lib\libbrawcap64.lib
+ *
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// STD
+// C
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+// CPP
+#include <string>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// bRAWcap
+#include "brawcap_receive.hpp"
+
+struct Options
+{
+  std::string adapter;
+  uint64_t seconds = 10;
+  size_t buffers = 4;
+  brawcap_buffer_packet_count_t packets = 4096;
+};
+
+// Filled by the timed completion entry point and the per packet work.
+struct Timing
+{
+  std::atomic<uint64_t> completionNs{0};
+  std::atomic<uint64_t> buffers{0};
+  std::atomic<uint64_t> packets{0};
+  std::atomic<uint64_t> bytes{0};
+};
+
+// The per packet work of both paths.
+inline static void BufferWalk(BRAWcapBuffer& buffer, Timing& timing)
+{
+  uint64_t packets = 0;
+  uint64_t bytes = 0;
+  buffer.ForEach([&packets, &bytes](const BRAWcapPacketView& view)
+  {
+    ++packets;
+    bytes += view.PayloadLength();
+  });
+  timing.packets.fetch_add(packets, std::memory_order_relaxed);
+  timing.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+// Replaces the completion entry point registered with the driver by a timed call of it. Base is the type the entry
+// point expects as user pointer.
+template<typename Bench, typename Base, brawcap_rx_callback_t Complete>
+static void TimedComplete(brawcap_handle_t* const pHandle, const brawcap_status_t status,
+  brawcap_buffer_t* const pBuffer, void* pUser)
+{
+  const auto start = std::chrono::steady_clock::now();
+  Complete(pHandle, status, pBuffer, pUser);
+  const auto end = std::chrono::steady_clock::now();
+  Timing& timing = static_cast<Bench*>(reinterpret_cast<Base*>(pUser))->m_timing;
+  timing.completionNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+    std::memory_order_relaxed);
+  timing.buffers.fetch_add(1, std::memory_order_relaxed);
+}
+
+// ReceiveStart() path: function pointer callback with the user pointer cast back.
+class CallbackBench : public BRAWcapReceive
+{
+public:
+  inline CallbackBench(const std::string& name)
+    : BRAWcapAdapter(name), BRAWcapHandle(name), BRAWcapReceive(name)
+  { }
+  
+  inline void Start()
+  {
+    ReceiveStart(Callback, &m_timing);
+    // Same callback and user pointer, only the entry point registered with the driver is wrapped.
+    brawcap_handle_t* const pHandle = BRAWcapHandle::Native().get();
+    brawcap_rx_callback_t const timed = TimedComplete<CallbackBench, BRAWcapReceive, ReceiveBufferCompleteInternal>;
+    if(!BRAWCAP_SUCCESS(brawcap_rx_stop(pHandle)) ||
+      !BRAWCAP_SUCCESS(brawcap_rx_start(pHandle, timed, static_cast<BRAWcapReceive*>(this), true)))
+      assert(false);
+  }
+  
+  Timing m_timing;
+  
+private:
+  inline static void Callback(BRAWcapBuffer& buffer, brawcap_status_t status, void* pUser)
+  {
+    if(BRAWCAP_SUCCESS(status))
+      BufferWalk(buffer, *reinterpret_cast<Timing*>(pUser));
+  }
+};
+
+struct WalkHandler
+{
+  Timing* pTiming;
+  
+  inline void operator()(BRAWcapBuffer& buffer)
+  {
+    BufferWalk(buffer, *pTiming);
+  }
+};
+
+// BRAWcapReceiveT path: the handler is inlined into the completion entry point.
+class TemplateBench : public BRAWcapReceiveT<WalkHandler>
+{
+public:
+  inline TemplateBench(const std::string& name)
+    : BRAWcapAdapter(name), BRAWcapHandle(name), BRAWcapReceiveT<WalkHandler>(name, WalkHandler{ &m_timing })
+  { }
+  
+  inline void Start()
+  {
+    if(!BRAWCAP_SUCCESS(brawcap_rx_start(BRAWcapHandle::Native().get(),
+      TimedComplete<TemplateBench, BRAWcapReceiveT<WalkHandler>, ReceiveBufferCompleteT>,
+      static_cast<BRAWcapReceiveT<WalkHandler>*>(this), true)))
+      assert(false);
+  }
+  
+  Timing m_timing;
+};
+
+static void Usage()
+{
+  printf("Usage:\n");
+  printf("  brawcap_bench_receive -a adapter [-t seconds per path] [-b buffers] [-p packets per buffer]\n");
+}
+
+static bool ParseArgs(int argc, char** argv, Options& options)
+{
+  for(int index = 1; index < argc; ++index)
+  {
+    const std::string arg = argv[index];
+    const bool hasValue = index + 1 < argc;
+    if(arg == "-a" && hasValue)
+      options.adapter = argv[++index];
+    else if(arg == "-t" && hasValue)
+      options.seconds = strtoull(argv[++index], nullptr, 0);
+    else if(arg == "-b" && hasValue)
+      options.buffers = strtoul(argv[++index], nullptr, 0);
+    else if(arg == "-p" && hasValue)
+      options.packets = static_cast<brawcap_buffer_packet_count_t>(strtoul(argv[++index], nullptr, 0));
+    else
+      return false;
+  }
+  return !options.adapter.empty() && options.seconds && options.buffers && options.packets;
+}
+
+template<typename Bench>
+static void Run(Bench& bench, const Options& options, const char* pName)
+{
+  for(size_t index = 0; index < options.buffers; ++index)
+    bench.ReceiveBufferAdd(BRAWCAP_PACKET_SIZE_MAX, options.packets);
+  bench.Start();
+  std::this_thread::sleep_for(std::chrono::seconds(options.seconds));
+  bench.ReceiveStop();
+  
+  const Timing& timing = bench.m_timing;
+  const uint64_t packets = timing.packets.load();
+  const uint64_t buffers = timing.buffers.load();
+  const uint64_t ns = timing.completionNs.load();
+  printf("%-14s %12llu %14llu %16llu %12.2f %12.1f\n", pName, static_cast<unsigned long long>(buffers),
+    static_cast<unsigned long long>(packets), static_cast<unsigned long long>(timing.bytes.load()),
+    packets ? static_cast<double>(ns) / packets : 0.0, buffers ? static_cast<double>(ns) / buffers : 0.0);
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if(!ParseArgs(argc, argv, options))
+  {
+    Usage();
+    return EXIT_FAILURE;
+  }
+  
+  printf("%-14s %12s %14s %16s %12s %12s\n", "path", "buffers", "packets", "bytes", "ns/packet", "ns/buffer");
+  {
+    CallbackBench bench(options.adapter);
+    Run(bench, options, "ReceiveStart");
+  }
+  {
+    TemplateBench bench(options.adapter);
+    Run(bench, options, "ReceiveT");
+  }
+  return EXIT_SUCCESS;
+}
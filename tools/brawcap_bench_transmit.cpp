@@ -0,0 +1,197 @@
+/**
+ * @file brawcap_bench_transmit.cpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Benchmark - transmit completion bookkeeping.
+ *
+ *
+ * Usage:
+ *   brawcap_bench_transmit -a adapter [-n completions] [-j threads]
+ *
+ * Measures the in-flight bookkeeping of BRAWcapTransmit: one tracked send plus one completion lookup, at 1, 64,
+ * 1024 and 4096 buffers in flight. Buffers complete in random order. The driver is not involved, the adapter is
+ * only needed to open the transmit handle. The cost per completion should not depend on the in-flight count.
+ *
+ * Build (MSVC, from the repository root):
+ *   cl /std:c++17 /O2 /EHsc /Isrc /Isdk\c\include tools\brawcap_bench_transmit.cpp sdk\c\lib\libbrawcap64.lib
+ *
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// STD
+// C
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+// CPP
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+// bRAWcap
+#include "brawcap_transmit.hpp"
+
+static const size_t IN_FLIGHT_LEVELS[] = { 1, 64, 1024, 4096 };
+
+struct Options
+{
+  std::string adapter;
+  uint64_t completions = 4000000;
+  size_t threads = 1;
+};
+
+struct Result
+{
+  double nsPerCompletion;
+  uint64_t allocations; // tracking nodes allocated during the measurement
+};
+
+class InFlightBench : public BRAWcapTransmit
+{
+public:
+  inline InFlightBench(const std::string& name)
+    : BRAWcapAdapter(name), BRAWcapHandle(name), BRAWcapTransmit(name)
+  { }
+  
+  // Keeps inFlight buffers tracked over all threads, each completion is followed by a new send of that buffer.
+  // Setup and a warm up pass, which creates the spare tracking nodes, are not measured.
+  inline Result Run(const size_t inFlight, const uint64_t completions, const size_t threads)
+  {
+    const size_t threadCount = std::min(threads, inFlight);
+    const uint64_t perThread = std::max<uint64_t>(1, completions / threadCount);
+    std::atomic<size_t> ready(0);
+    std::atomic<size_t> done(0);
+    std::atomic<bool> go(false);
+    std::atomic<bool> finish(false);
+    std::vector<std::thread> workers;
+    for(size_t thread = 0; thread < threadCount; ++thread)
+    {
+      const size_t buffers = inFlight / threadCount + (thread < inFlight % threadCount ? 1 : 0);
+      workers.emplace_back([&, buffers, thread]()
+      {
+        Worker(buffers, perThread, thread, ready, done, go, finish);
+      });
+    }
+    
+    while(ready.load() < threadCount)
+      std::this_thread::yield();
+    PoolStats before;
+    TransmitBufferPoolStatistics(before);
+    const auto start = std::chrono::steady_clock::now();
+    go = true;
+    while(done.load() < threadCount)
+      std::this_thread::yield();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    PoolStats after;
+    TransmitBufferPoolStatistics(after);
+    finish = true;
+    for(auto& worker : workers)
+      worker.join();
+    return { seconds * 1e9 / (perThread * threadCount), after.trackingAllocations - before.trackingAllocations };
+  }
+  
+private:
+  inline void Worker(const size_t count, const uint64_t completions, const size_t seed, std::atomic<size_t>& ready,
+    std::atomic<size_t>& done, const std::atomic<bool>& go, const std::atomic<bool>& finish)
+  {
+    std::vector<BRAWcapBuffer> buffers;
+    std::vector<brawcap_buffer_t*> natives;
+    buffers.reserve(count);
+    for(size_t index = 0; index < count; ++index)
+    {
+      buffers.emplace_back(64, 1);
+      natives.push_back(TransmitBufferTrack(buffers.back()));
+    }
+    
+    uint64_t random = 0x9E3779B97F4A7C15ULL ^ (seed + 1);
+    Complete(buffers, natives, std::max<uint64_t>(completions / 10, count * 4), random);
+    ready.fetch_add(1);
+    while(!go.load())
+      std::this_thread::yield();
+    Complete(buffers, natives, completions, random);
+    done.fetch_add(1);
+    while(!finish.load())
+      std::this_thread::yield();
+    
+    for(brawcap_buffer_t* pBuffer : natives)
+      TransmitBufferCompleteInternal(BRAWcapHandle::Native().get(), BRAWCAP_STATUS_SUCCESS, pBuffer, this);
+  }
+  
+  // Completes random in-flight buffers and sends each again.
+  inline void Complete(std::vector<BRAWcapBuffer>& buffers, std::vector<brawcap_buffer_t*>& natives,
+    const uint64_t completions, uint64_t& random)
+  {
+    brawcap_handle_t* const pHandle = BRAWcapHandle::Native().get();
+    for(uint64_t completion = 0; completion < completions; ++completion)
+    {
+      random ^= random << 13;
+      random ^= random >> 7;
+      random ^= random << 17;
+      const size_t index = static_cast<size_t>(random % buffers.size());
+      TransmitBufferCompleteInternal(pHandle, BRAWCAP_STATUS_SUCCESS, natives[index], this);
+      natives[index] = TransmitBufferTrack(buffers[index]);
+    }
+  }
+};
+
+static void Usage()
+{
+  printf("Usage:\n");
+  printf("  brawcap_bench_transmit -a adapter [-n completions] [-j threads]\n");
+}
+
+static bool ParseArgs(int argc, char** argv, Options& options)
+{
+  for(int index = 1; index < argc; ++index)
+  {
+    const std::string arg = argv[index];
+    const bool hasValue = index + 1 < argc;
+    if(arg == "-a" && hasValue)
+      options.adapter = argv[++index];
+    else if(arg == "-n" && hasValue)
+      options.completions = strtoull(argv[++index], nullptr, 0);
+    else if(arg == "-j" && hasValue)
+      options.threads = std::max(1UL, strtoul(argv[++index], nullptr, 0));
+    else
+      return false;
+  }
+  return !options.adapter.empty() && options.completions;
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if(!ParseArgs(argc, argv, options))
+  {
+    Usage();
+    return EXIT_FAILURE;
+  }
+  
+  InFlightBench bench(options.adapter);
+  printf("%10s %14s %14s %12s\n", "in flight", "ns/completion", "completions/s", "allocations");
+  for(const size_t inFlight : IN_FLIGHT_LEVELS)
+  {
+    const Result result = bench.Run(inFlight, options.completions, options.threads);
+    printf("%10zu %14.1f %14.0f %12llu\n", inFlight, result.nsPerCompletion, 1e9 / result.nsPerCompletion,
+      static_cast<unsigned long long>(result.allocations));
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,473 @@
+/**
+ * @file brawcap_generator.cpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Tool - traffic generator.
+ *
+ *
+ * Usage:
+ *   brawcap_generator -a adapter [-a adapter ...] (-r bits/s | -p packets/s) [profile] [options]
+ *
+ * Profiles (frame sizes include the FCS, like the adapter speed):
+ *   --size bytes                 fixed size (default 64)
+ *   --imix                       simple IMIX, 64/594/1518 bytes in the ratio 7:4:1
+ *   --hist size:weight,...       custom size histogram, e.g. 64:10,512:3,1518:1
+ *   --burst on_ms:off_ms         combined with any of the above: send for on_ms, then pause for off_ms
+ *
+ * Every adapter gets its own BRAWcapTransmit and paced sender thread running at the given rate. Frames are
+ * Ethernet/IPv4/UDP built by BRAWcapFrameTemplate, the source port walks over the flows and the IPv4 identification
+ * counts. Transmit statistics of the driver (completed and canceled packets and bytes) are reported every interval.
+ *
+ * Build (MSVC, from the repository root):
+ *   cl /std:c++17 /O2 /EHsc /Isrc /Isdk\c\include tools\brawcap_generator.cpp sdk\c\lib\libbrawcap64.lib
+ *
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// STD
+// C
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+// CPP
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+// bRAWcap
+#include "brawcap_adapter.hpp"
+#include "brawcap_transmit.hpp"
+#include "brawcap_paced_sender.hpp"
+#include "brawcap_frame_template.hpp"
+
+static constexpr uint32_t FCS_BYTES = BRAWcapPacedSender::FCS_BYTES;
+static constexpr size_t SCHEDULE_SIZE_MAX = 4096;
+static constexpr uint64_t PAUSE_SLICE_MS = 100;
+
+struct SizeWeight
+{
+  uint32_t size; // frame size including FCS
+  uint32_t weight;
+};
+
+struct Options
+{
+  std::vector<std::string> adapters;
+  BRAWcapPacedSender::RateUnit unit = BRAWcapPacedSender::RateUnit::BITS_PER_SECOND;
+  double rate = 0;
+  std::vector<SizeWeight> sizes;
+  uint64_t burstOnMs = 0;
+  uint64_t burstOffMs = 0;
+  uint64_t seconds = 0; // 0: until Ctrl+C
+  uint64_t intervalSeconds = 1;
+  uint8_t dstMac[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  uint32_t srcIp = 0xC0A80001; // 192.168.0.1
+  uint32_t dstIp = 0xC0A80002; // 192.168.0.2
+  uint16_t srcPort = 49152;
+  uint16_t dstPort = 9; // discard
+  uint16_t flows = 1;
+  uint16_t vlanId = 0;
+};
+
+// Frames of one size.
+struct Source
+{
+  std::unique_ptr<BRAWcapFrameTemplate> pTemplate;
+};
+
+struct Generator
+{
+  const Options* pOptions = nullptr;
+  std::string adapter;
+  std::unique_ptr<BRAWcapTransmit> pTransmit;
+  std::unique_ptr<BRAWcapPacedSender> pSender;
+  std::vector<Source> sources;
+  std::vector<uint16_t> schedule; // source index per packet, repeated
+  size_t next = 0;
+  std::chrono::steady_clock::time_point start;
+  brawcap_stats_tx_t last = {};
+};
+
+static std::atomic<bool> g_stop(false);
+
+static void SignalHandler(int)
+{
+  g_stop = true;
+}
+
+static void Usage()
+{
+  printf("Usage:\n");
+  printf("  brawcap_generator --list\n");
+  printf("  brawcap_generator -a adapter [-a adapter ...] (-r bits/s | -p packets/s) [profile] [options]\n");
+  printf("Profiles: --size bytes | --imix | --hist size:weight,... and optionally --burst on_ms:off_ms\n");
+  printf("Options: -t seconds, -i report interval seconds, --dst-mac xx:xx:xx:xx:xx:xx, --src-ip a.b.c.d,\n");
+  printf("         --dst-ip a.b.c.d, --src-port port, --dst-port port, --flows count, --vlan id\n");
+  printf("Rates take the suffixes k, M and G, bit rates include preamble, FCS and inter frame gap.\n");
+}
+
+static double RateParse(const char* pText)
+{
+  char* pEnd = nullptr;
+  double value = strtod(pText, &pEnd);
+  if(*pEnd == 'k' || *pEnd == 'K')
+    value *= 1e3;
+  else if(*pEnd == 'M')
+    value *= 1e6;
+  else if(*pEnd == 'G')
+    value *= 1e9;
+  return value;
+}
+
+static bool MacParse(const char* pText, uint8_t mac[6])
+{
+  unsigned int bytes[6] = {};
+  if(sscanf(pText, "%x:%x:%x:%x:%x:%x", &bytes[0], &bytes[1], &bytes[2], &bytes[3], &bytes[4], &bytes[5]) != 6)
+    return false;
+  for(size_t index = 0; index < 6; ++index)
+    mac[index] = static_cast<uint8_t>(bytes[index]);
+  return true;
+}
+
+static bool Ipv4Parse(const char* pText, uint32_t& ip)
+{
+  unsigned int bytes[4] = {};
+  if(sscanf(pText, "%u.%u.%u.%u", &bytes[0], &bytes[1], &bytes[2], &bytes[3]) != 4)
+    return false;
+  ip = bytes[0] << 24 | bytes[1] << 16 | bytes[2] << 8 | bytes[3];
+  return true;
+}
+
+static bool HistogramParse(const char* pText, std::vector<SizeWeight>& sizes)
+{
+  sizes.clear();
+  while(*pText)
+  {
+    char* pEnd = nullptr;
+    const uint32_t size = strtoul(pText, &pEnd, 10);
+    if(*pEnd != ':')
+      return false;
+    const uint32_t weight = strtoul(pEnd + 1, &pEnd, 10);
+    if(*pEnd && *pEnd != ',')
+      return false;
+    if(weight)
+      sizes.push_back({ size, weight });
+    pText = *pEnd ? pEnd + 1 : pEnd;
+  }
+  return !sizes.empty();
+}
+
+static bool ParseArgs(int argc, char** argv, Options& options)
+{
+  for(int index = 1; index < argc; ++index)
+  {
+    const std::string arg = argv[index];
+    const bool hasValue = index + 1 < argc;
+    if(arg == "-a" && hasValue)
+      options.adapters.push_back(argv[++index]);
+    else if(arg == "-r" && hasValue)
+    {
+      options.unit = BRAWcapPacedSender::RateUnit::BITS_PER_SECOND;
+      options.rate = RateParse(argv[++index]);
+    }
+    else if(arg == "-p" && hasValue)
+    {
+      options.unit = BRAWcapPacedSender::RateUnit::PACKETS_PER_SECOND;
+      options.rate = RateParse(argv[++index]);
+    }
+    else if(arg == "-t" && hasValue)
+      options.seconds = strtoull(argv[++index], nullptr, 0);
+    else if(arg == "-i" && hasValue)
+      options.intervalSeconds = std::max(1ULL, strtoull(argv[++index], nullptr, 0));
+    else if(arg == "--size" && hasValue)
+      options.sizes = { { static_cast<uint32_t>(strtoul(argv[++index], nullptr, 0)), 1 } };
+    else if(arg == "--imix")
+      options.sizes = { { 64, 7 }, { 594, 4 }, { 1518, 1 } };
+    else if(arg == "--hist" && hasValue)
+    {
+      if(!HistogramParse(argv[++index], options.sizes))
+        return false;
+    }
+    else if(arg == "--burst" && hasValue)
+    {
+      unsigned long long onMs = 0;
+      unsigned long long offMs = 0;
+      if(sscanf(argv[++index], "%llu:%llu", &onMs, &offMs) != 2 || !onMs)
+        return false;
+      options.burstOnMs = onMs;
+      options.burstOffMs = offMs;
+    }
+    else if(arg == "--dst-mac" && hasValue)
+    {
+      if(!MacParse(argv[++index], options.dstMac))
+        return false;
+    }
+    else if(arg == "--src-ip" && hasValue)
+    {
+      if(!Ipv4Parse(argv[++index], options.srcIp))
+        return false;
+    }
+    else if(arg == "--dst-ip" && hasValue)
+    {
+      if(!Ipv4Parse(argv[++index], options.dstIp))
+        return false;
+    }
+    else if(arg == "--src-port" && hasValue)
+      options.srcPort = static_cast<uint16_t>(strtoul(argv[++index], nullptr, 0));
+    else if(arg == "--dst-port" && hasValue)
+      options.dstPort = static_cast<uint16_t>(strtoul(argv[++index], nullptr, 0));
+    else if(arg == "--flows" && hasValue)
+      options.flows = static_cast<uint16_t>(std::max(1UL, strtoul(argv[++index], nullptr, 0)));
+    else if(arg == "--vlan" && hasValue)
+      options.vlanId = static_cast<uint16_t>(strtoul(argv[++index], nullptr, 0) & 0x0FFF);
+    else
+      return false;
+  }
+  
+  if(options.sizes.empty())
+    options.sizes = { { 64, 1 } };
+  const uint32_t sizeMin = static_cast<uint32_t>(BRAWcapFrameTemplate::ETHERNET_HEADER_SIZE +
+    (options.vlanId ? BRAWcapFrameTemplate::VLAN_TAG_SIZE : 0) + BRAWcapFrameTemplate::IPV4_HEADER_SIZE +
+    BRAWcapFrameTemplate::UDP_HEADER_SIZE + FCS_BYTES);
+  for(const SizeWeight& entry : options.sizes)
+  {
+    if(entry.size < sizeMin || entry.size - FCS_BYTES > BRAWCAP_PACKET_SIZE_MAX)
+    {
+      printf("[ERROR] Frame size %u is out of range (%u to %u bytes).\n", entry.size, sizeMin,
+        BRAWCAP_PACKET_SIZE_MAX + FCS_BYTES);
+      return false;
+    }
+  }
+  return !options.adapters.empty() && options.rate > 0;
+}
+
+// Spreads the sizes evenly by their weights (7:4:1 becomes 64 594 64 64 1518 ...), scaled down to
+// SCHEDULE_SIZE_MAX entries if needed.
+static std::vector<uint16_t> ScheduleBuild(const std::vector<SizeWeight>& sizes)
+{
+  uint64_t total = 0;
+  for(const SizeWeight& entry : sizes)
+    total += entry.weight;
+  const double scale = total > SCHEDULE_SIZE_MAX ? static_cast<double>(SCHEDULE_SIZE_MAX) / total : 1.0;
+  
+  std::vector<std::pair<double, uint16_t>> positions;
+  for(size_t source = 0; source < sizes.size(); ++source)
+  {
+    const uint64_t count = std::max<uint64_t>(1, static_cast<uint64_t>(sizes[source].weight * scale + 0.5));
+    for(uint64_t index = 0; index < count; ++index)
+      positions.push_back({ (index + 0.5) / count, static_cast<uint16_t>(source) });
+  }
+  std::stable_sort(positions.begin(), positions.end(),
+    [](const std::pair<double, uint16_t>& a, const std::pair<double, uint16_t>& b) { return a.first < b.first; });
+  
+  std::vector<uint16_t> schedule;
+  for(const auto& position : positions)
+    schedule.push_back(position.second);
+  return schedule;
+}
+
+static void SourcesBuild(Generator& generator)
+{
+  const Options& options = *generator.pOptions;
+  brawcap_adapter_mac_t srcMac = { 0 };
+  generator.pTransmit->AdapterMac(srcMac);
+  
+  for(const SizeWeight& entry : options.sizes)
+  {
+    Source source;
+    source.pTemplate = std::make_unique<BRAWcapFrameTemplate>(BRAWcapFrameTemplate::Ipv4Udp(options.dstMac, srcMac,
+      options.srcIp, options.dstIp, options.srcPort, options.dstPort, entry.size - FCS_BYTES, options.vlanId));
+    BRAWcapFrameTemplate& frameTemplate = *source.pTemplate;
+    frameTemplate.FieldAdd(frameTemplate.Ipv4Offset() + 4, 2, 0); // identification
+    if(options.flows > 1)
+      frameTemplate.FieldAdd(frameTemplate.UdpOffset(), 2, options.srcPort, 1, options.flows);
+    generator.sources.push_back(std::move(source));
+  }
+  generator.schedule = ScheduleBuild(options.sizes);
+}
+
+// Sleeps through the pause of the burst pattern, false if stopped meanwhile.
+static bool BurstWait(const Generator& generator)
+{
+  const Options& options = *generator.pOptions;
+  if(!options.burstOffMs)
+    return true;
+  const uint64_t periodMs = options.burstOnMs + options.burstOffMs;
+  for(;;)
+  {
+    const uint64_t elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - generator.start).count();
+    const uint64_t phaseMs = elapsedMs % periodMs;
+    if(phaseMs < options.burstOnMs)
+      return true;
+    if(g_stop)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(std::min(PAUSE_SLICE_MS, periodMs - phaseMs)));
+  }
+}
+
+static size_t Fill(BRAWcapBuffer& buffer, size_t maxPackets, void* pUser)
+{
+  Generator& generator = *static_cast<Generator*>(pUser);
+  if(g_stop || !BurstWait(generator))
+    return 0;
+  
+  // Sizes interleave packet by packet, each template renders its frame in place in the buffer.
+  size_t added = 0;
+  for(; added < maxPackets; ++added)
+  {
+    if(!generator.sources[generator.schedule[generator.next]].pTemplate->Fill(buffer, 1))
+      break;
+    generator.next = (generator.next + 1) % generator.schedule.size();
+  }
+  return added;
+}
+
+// The driver fills the statistics revision requested in the header.
+static void TransmitStatistics(const Generator& generator, brawcap_stats_tx_t& stats)
+{
+  stats = {};
+  stats.header.type = BRAWCAP_STATS_TYPE_TX;
+  stats.header.revision = BRAWCAP_STATS_TX_REVISION_1;
+  stats.header.size = BRAWCAP_STATS_TX_SIZEOF_REVISION_1;
+  generator.pTransmit->StatsTransmitStatistics(stats);
+}
+
+static void Report(std::vector<std::unique_ptr<Generator>>& generators, const double seconds)
+{
+  for(auto& pGenerator : generators)
+  {
+    brawcap_stats_tx_t stats;
+    TransmitStatistics(*pGenerator, stats);
+    const brawcap_stats_tx_t& last = pGenerator->last;
+    const uint64_t packets = stats.handleCompletedPacketsTotal - last.handleCompletedPacketsTotal;
+    const uint64_t bytes = stats.handleCompletedBytesTotal - last.handleCompletedBytesTotal;
+    printf("%s: %.3f Mpps %.3f Gbit/s | completed %llu packets %llu bytes, canceled %llu packets",
+      pGenerator->adapter.c_str(), packets / seconds / 1e6, bytes * 8 / seconds / 1e9,
+      static_cast<unsigned long long>(stats.handleCompletedPacketsTotal),
+      static_cast<unsigned long long>(stats.handleCompletedBytesTotal),
+      static_cast<unsigned long long>(stats.handleCanceledPacketsTotal));
+    if(BRAWCAP_STATS_TX_ADAPTER_COMPLETED_PACKETS_TOTAL_VALID(stats))
+      printf(" | adapter completed %llu packets", static_cast<unsigned long long>(stats.adapterCompletedPacketsTotal));
+    if(BRAWCAP_STATS_TX_ADAPTER_COMPLETED_BYTES_TOTAL_VALID(stats))
+      printf(" %llu bytes", static_cast<unsigned long long>(stats.adapterCompletedBytesTotal));
+    if(BRAWCAP_STATS_TX_ADAPTER_CANCELED_PACKETS_TOTAL_VALID(stats))
+      printf(", canceled %llu packets", static_cast<unsigned long long>(stats.adapterCanceledPacketsTotal));
+    printf("\n");
+    pGenerator->last = stats;
+  }
+}
+
+static void Summary(const std::vector<std::unique_ptr<Generator>>& generators)
+{
+  for(const auto& pGenerator : generators)
+  {
+    BRAWcapPacedSender::Stats stats;
+    pGenerator->pSender->Statistics(stats);
+    // The achieved rate is measured from the driver transmit timestamps of the completed packets.
+    printf("%s: sent %llu packets %llu bytes, %llu completed, %.3f Mpps %.3f Gbit/s (%+.3f %% of the rate), jitter "
+      "mean %llu ns max %llu ns, %llu pool waits, %llu send failures\n", pGenerator->adapter.c_str(),
+      static_cast<unsigned long long>(stats.packetsSent), static_cast<unsigned long long>(stats.bytesSent),
+      static_cast<unsigned long long>(stats.packetsCompleted), stats.achievedPacketsPerSecond / 1e6,
+      stats.achievedBitsPerSecond / 1e9, stats.rateErrorPercent,
+      static_cast<unsigned long long>(stats.jitterMeanNs), static_cast<unsigned long long>(stats.jitterMaxNs),
+      static_cast<unsigned long long>(stats.poolWaits), static_cast<unsigned long long>(stats.sendFailures));
+    if(stats.ceilingBitsPerSecond && pGenerator->pOptions->unit == BRAWcapPacedSender::RateUnit::BITS_PER_SECOND &&
+      pGenerator->pOptions->rate > stats.ceilingBitsPerSecond)
+      printf("[WARNING] %s: rate is above the adapter speed of %.3f Gbit/s.\n", pGenerator->adapter.c_str(),
+        stats.ceilingBitsPerSecond / 1e9);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  if(argc == 2 && std::string(argv[1]) == "--list")
+  {
+    for(const auto& adapter : BRAWcapAdapter::AdapterList())
+      printf("%s\n", adapter.c_str());
+    return EXIT_SUCCESS;
+  }
+  
+  Options options;
+  if(!ParseArgs(argc, argv, options))
+  {
+    Usage();
+    return EXIT_FAILURE;
+  }
+  std::signal(SIGINT, SignalHandler);
+  
+  uint32_t sizeMax = 0;
+  for(const SizeWeight& entry : options.sizes)
+    sizeMax = std::max(sizeMax, entry.size - FCS_BYTES);
+  BRAWcapPacedSender::Config config;
+  config.unit = options.unit;
+  config.rate = options.rate;
+  config.maxPacketPayloadSize = sizeMax;
+  
+  // One transmit handle and paced sender thread per adapter, the fill callbacks run on the sender threads.
+  std::vector<std::unique_ptr<Generator>> generators;
+  for(const auto& adapter : options.adapters)
+  {
+    auto pGenerator = std::make_unique<Generator>();
+    pGenerator->pOptions = &options;
+    pGenerator->adapter = adapter;
+    pGenerator->pTransmit = std::make_unique<BRAWcapTransmit>(adapter);
+    pGenerator->pSender = std::make_unique<BRAWcapPacedSender>(*pGenerator->pTransmit, config);
+    SourcesBuild(*pGenerator);
+    TransmitStatistics(*pGenerator, pGenerator->last);
+    generators.push_back(std::move(pGenerator));
+  }
+  
+  const auto start = std::chrono::steady_clock::now();
+  for(auto& pGenerator : generators)
+  {
+    pGenerator->start = start;
+    pGenerator->pSender->Start(Fill, pGenerator.get());
+  }
+  
+  auto reported = start;
+  while(!g_stop)
+  {
+    std::this_thread::sleep_until(reported + std::chrono::seconds(options.intervalSeconds));
+    const auto now = std::chrono::steady_clock::now();
+    Report(generators, std::chrono::duration<double>(now - reported).count());
+    reported = now;
+    if(options.seconds && now - start >= std::chrono::seconds(options.seconds))
+      g_stop = true;
+  }
+  
+  for(auto& pGenerator : generators)
+    pGenerator->pSender->Stop();
+  Report(generators, std::chrono::duration<double>(std::chrono::steady_clock::now() - reported).count());
+  Summary(generators);
+  
+  bool ok = true;
+  for(const auto& pGenerator : generators)
+  {
+    BRAWcapPacedSender::Stats stats;
+    pGenerator->pSender->Statistics(stats);
+    ok = ok && !stats.sendFailures;
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
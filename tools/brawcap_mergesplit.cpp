@@ -0,0 +1,559 @@
+/**
+ * @file brawcap_mergesplit.cpp
+ * @authors johannes.fellinger@b-plus.com
+ * @brief bRAWcap CPP Wrapper Tool - parallel capture file merge and split.
+ *
+ * Usage:
+ *   brawcap_mergesplit merge [-j threads] -o out.pcap in1.pcap in2.pcapng ...
+ *   brawcap_mergesplit split [-j threads] -o prefix (--flow buckets | --vlan | --time seconds) in.pcap
+ *
+ * merge interleaves the inputs by timestamp. The time range is cut into slices which are merged in parallel
+ * (k-way heap merge per slice) and written in order. split classifies chunks of the input in parallel and writes
+ * the output files in parallel, every output keeps the input order. Inputs are memory mapped, outputs are
+ * nanosecond pcap files written by BRAWcapPcapWriter.
+ *
+ * Build (MSVC, from the repository root):
+ *   cl /std:c++17 /O2 /EHsc /Isrc /Isdk\c\include tools\brawcap_mergesplit.cpp sdk\c\lib\libbrawcap64.lib
+ *
+ * @copyright
+ * <b> The MIT License (MIT)
+ * Copyright © 2021 b-plus technologies GmbH. </b>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the “Software”), to deal in the  *Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of
+ * the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// STD
+// C
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+// CPP
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <queue>
+#include <tuple>
+#include <functional>
+
+// bRAWcap
+#include "brawcap_file_reader.hpp"
+#include "brawcap_pcap_writer.hpp"
+#include "brawcap_flow.hpp"
+
+// Largest snap length libpcap accepts, inputs may come from any capture tool.
+static constexpr uint32_t SNAP_LENGTH = 262144;
+static constexpr uint64_t SLICE_BYTES = 64ULL * 1024 * 1024;
+static constexpr size_t SPLIT_STAGING_SIZE = 1024 * 1024;
+
+enum class SplitMode
+{
+  NONE,
+  FLOW,
+  VLAN,
+  TIME
+};
+
+struct Options
+{
+  std::string command;
+  std::string output;
+  std::vector<std::string> inputs;
+  size_t threads = 0;
+  SplitMode splitMode = SplitMode::NONE;
+  uint64_t splitValue = 0;
+};
+
+struct Totals
+{
+  std::atomic<uint64_t> packets{0};
+  std::atomic<uint64_t> bytes{0};
+  std::atomic<uint64_t> failed{0};
+  std::atomic<uint64_t> late{0};
+};
+
+static void Usage()
+{
+  printf("Usage:\n");
+  printf("  brawcap_mergesplit merge [-j threads] -o out.pcap in1 in2 ...\n");
+  printf("  brawcap_mergesplit split [-j threads] -o prefix (--flow buckets | --vlan | --time seconds) in\n");
+}
+
+static bool ParseArgs(int argc, char** argv, Options& options)
+{
+  if(argc < 2)
+    return false;
+  options.command = argv[1];
+  for(int index = 2; index < argc; ++index)
+  {
+    const std::string arg = argv[index];
+    const bool hasValue = index + 1 < argc;
+    if(arg == "-o" && hasValue)
+      options.output = argv[++index];
+    else if(arg == "-j" && hasValue)
+      options.threads = strtoul(argv[++index], nullptr, 0);
+    else if(arg == "--flow" && hasValue)
+    {
+      options.splitMode = SplitMode::FLOW;
+      options.splitValue = strtoull(argv[++index], nullptr, 0);
+    }
+    else if(arg == "--time" && hasValue)
+    {
+      options.splitMode = SplitMode::TIME;
+      options.splitValue = strtoull(argv[++index], nullptr, 0) * 1000000000ULL;
+    }
+    else if(arg == "--vlan")
+      options.splitMode = SplitMode::VLAN;
+    else if(arg[0] == '-')
+      return false;
+    else
+      options.inputs.push_back(arg);
+  }
+  
+  if(!options.threads)
+    options.threads = std::max(1U, std::thread::hardware_concurrency());
+  if(options.output.empty() || options.inputs.empty())
+    return false;
+  if(options.command == "merge")
+    return true;
+  return options.command == "split" && options.inputs.size() == 1 && options.splitMode != SplitMode::NONE &&
+    (options.splitMode == SplitMode::VLAN || options.splitValue);
+}
+
+static bool InputsOpen(const std::vector<std::string>& paths, std::vector<std::unique_ptr<BRAWcapFileReader>>& readers)
+{
+  for(const auto& path : paths)
+  {
+    readers.push_back(std::make_unique<BRAWcapFileReader>());
+    if(!readers.back()->Open(path))
+    {
+      printf("[ERROR] Could not open %s (missing or not a pcap/pcapng file).\n", path.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// Merge
+
+// Record offsets and the first timestamp of equally sized chunks, used to find time positions without a full walk.
+struct Chunks
+{
+  std::vector<uint64_t> points;
+  std::vector<uint64_t> firstNs; // UINT64_MAX for empty chunks
+};
+
+static Chunks ChunksScan(BRAWcapFileReader& reader, const size_t count)
+{
+  Chunks chunks;
+  chunks.points = reader.ResyncPoints(count);
+  chunks.firstNs.assign(count, UINT64_MAX);
+  for(size_t index = 0; index < count; ++index)
+  {
+    reader.ForEachRange([&chunks, index](const BRAWcapFilePacket& packet)
+    {
+      chunks.firstNs[index] = packet.TimestampTotalNs();
+      return false;
+    }, chunks.points[index], chunks.points[index + 1]);
+  }
+  return chunks;
+}
+
+// Offset of the first record at or after timeNs, assuming the input is about time ordered.
+static uint64_t Seek(BRAWcapFileReader& reader, const Chunks& chunks, const uint64_t timeNs)
+{
+  size_t start = 0;
+  for(size_t index = 0; index < chunks.firstNs.size(); ++index)
+  {
+    if(chunks.firstNs[index] != UINT64_MAX && chunks.firstNs[index] < timeNs)
+      start = index;
+  }
+  
+  uint64_t offset = reader.Size();
+  reader.ForEachRange([&offset, timeNs](const BRAWcapFilePacket& packet)
+  {
+    if(packet.TimestampTotalNs() < timeNs)
+      return true;
+    offset = packet.FileOffset();
+    return false;
+  }, chunks.points[start], reader.Size());
+  return offset;
+}
+
+// Merges the packets of one slice, every input contributes the records in [bounds[input][slice], [slice + 1]).
+static void SliceMerge(std::vector<std::unique_ptr<BRAWcapFileReader>>& readers,
+  const std::vector<std::vector<uint64_t>>& bounds, const size_t slice, std::vector<BRAWcapFilePacket>& merged)
+{
+  std::vector<std::vector<BRAWcapFilePacket>> runs(readers.size());
+  size_t total = 0;
+  for(size_t input = 0; input < readers.size(); ++input)
+  {
+    std::vector<BRAWcapFilePacket>& run = runs[input];
+    readers[input]->ForEachRange([&run](const BRAWcapFilePacket& packet)
+    {
+      run.push_back(packet);
+    }, bounds[input][slice], bounds[input][slice + 1]);
+    
+    const auto earlier = [](const BRAWcapFilePacket& a, const BRAWcapFilePacket& b)
+    {
+      return a.TimestampTotalNs() < b.TimestampTotalNs();
+    };
+    if(!std::is_sorted(run.begin(), run.end(), earlier))
+      std::stable_sort(run.begin(), run.end(), earlier);
+    total += run.size();
+  }
+  
+  // Heap entries are (timestamp, input, position), ties resolve to the lower input index.
+  typedef std::tuple<uint64_t, size_t, size_t> Head;
+  std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+  for(size_t input = 0; input < runs.size(); ++input)
+  {
+    if(!runs[input].empty())
+      heads.emplace(runs[input][0].TimestampTotalNs(), input, 0);
+  }
+  
+  merged.clear();
+  merged.reserve(total);
+  while(!heads.empty())
+  {
+    const Head head = heads.top();
+    heads.pop();
+    const size_t input = std::get<1>(head);
+    const size_t position = std::get<2>(head);
+    merged.push_back(runs[input][position]);
+    if(position + 1 < runs[input].size())
+      heads.emplace(runs[input][position + 1].TimestampTotalNs(), input, position + 1);
+  }
+}
+
+static bool Merge(const Options& options, Totals& totals)
+{
+  std::vector<std::unique_ptr<BRAWcapFileReader>> readers;
+  if(!InputsOpen(options.inputs, readers))
+    return false;
+  // The output has a single link type, packets must not be relabeled.
+  for(size_t input = 1; input < readers.size(); ++input)
+  {
+    if(readers[input]->LinkType() != readers[0]->LinkType())
+    {
+      printf("[ERROR] %s has link type %u, %s has %u. Inputs of different link types cannot be merged.\n",
+        options.inputs[input].c_str(), readers[input]->LinkType(), options.inputs[0].c_str(), readers[0]->LinkType());
+      return false;
+    }
+  }
+  
+  uint64_t bytesTotal = 0;
+  for(const auto& reader : readers)
+    bytesTotal += reader->Size();
+  const size_t sliceCount = static_cast<size_t>(std::max<uint64_t>(options.threads * 4, bytesTotal / SLICE_BYTES));
+  
+  // Slice boundaries are quantiles of the chunk start times over all inputs.
+  std::vector<Chunks> chunks(readers.size());
+  std::vector<uint64_t> samples;
+  for(size_t input = 0; input < readers.size(); ++input)
+  {
+    const size_t count = static_cast<size_t>(std::max<uint64_t>(1, readers[input]->Size() * sliceCount * 4 /
+      std::max<uint64_t>(1, bytesTotal)));
+    chunks[input] = ChunksScan(*readers[input], count);
+    for(const uint64_t firstNs : chunks[input].firstNs)
+    {
+      if(firstNs != UINT64_MAX)
+        samples.push_back(firstNs);
+    }
+  }
+  std::sort(samples.begin(), samples.end());
+  
+  std::vector<uint64_t> times(sliceCount + 1, UINT64_MAX);
+  times[0] = 0;
+  for(size_t slice = 1; slice < sliceCount && !samples.empty(); ++slice)
+    times[slice] = samples[slice * samples.size() / sliceCount];
+  
+  // Offsets per input and boundary, made monotonic so every record belongs to exactly one slice.
+  std::vector<std::vector<uint64_t>> bounds(readers.size(), std::vector<uint64_t>(sliceCount + 1));
+  std::vector<std::thread> seekers;
+  for(size_t input = 0; input < readers.size(); ++input)
+  {
+    seekers.emplace_back([&, input]()
+    {
+      std::vector<uint64_t>& offsets = bounds[input];
+      offsets[0] = readers[input]->DataStart();
+      offsets[sliceCount] = readers[input]->Size();
+      for(size_t slice = 1; slice < sliceCount; ++slice)
+        offsets[slice] = times[slice] == UINT64_MAX ? readers[input]->Size() :
+          std::max(offsets[slice - 1], Seek(*readers[input], chunks[input], times[slice]));
+    });
+  }
+  for(auto& seeker : seekers)
+    seeker.join();
+  
+  BRAWcapPcapWriter writer;
+  if(!writer.Open(options.output, SNAP_LENGTH, readers[0]->LinkType()))
+  {
+    printf("[ERROR] Could not create %s.\n", options.output.c_str());
+    return false;
+  }
+  
+  // Slices are merged in parallel and written in order, at most two slices per thread are held in memory.
+  const size_t window = options.threads * 2;
+  std::vector<std::vector<BRAWcapFilePacket>> results(sliceCount);
+  std::vector<bool> ready(sliceCount, false);
+  std::mutex lock;
+  std::condition_variable wakeup;
+  size_t written = 0;
+  std::atomic<size_t> nextSlice(0);
+  
+  std::vector<std::thread> workers;
+  for(size_t index = 0; index < options.threads; ++index)
+  {
+    workers.emplace_back([&]()
+    {
+      for(;;)
+      {
+        const size_t slice = nextSlice.fetch_add(1);
+        if(slice >= sliceCount)
+          break;
+        {
+          std::unique_lock<std::mutex> localLock(lock);
+          wakeup.wait(localLock, [&]()
+          {
+            return slice < written + window;
+          });
+        }
+        
+        std::vector<BRAWcapFilePacket> merged;
+        SliceMerge(readers, bounds, slice, merged);
+        {
+          std::lock_guard<std::mutex> localLock(lock);
+          results[slice] = std::move(merged);
+          ready[slice] = true;
+        }
+        wakeup.notify_all();
+      }
+    });
+  }
+  
+  for(size_t slice = 0; slice < sliceCount; ++slice)
+  {
+    std::vector<BRAWcapFilePacket> merged;
+    {
+      std::unique_lock<std::mutex> localLock(lock);
+      wakeup.wait(localLock, [&]()
+      {
+        return ready[slice];
+      });
+      merged = std::move(results[slice]);
+    }
+    
+    for(const BRAWcapFilePacket& packet : merged)
+    {
+      if(writer.Write(packet))
+      {
+        ++totals.packets;
+        totals.bytes += packet.PayloadLength();
+      }
+      else
+        ++totals.failed;
+    }
+    {
+      std::lock_guard<std::mutex> localLock(lock);
+      written = slice + 1;
+    }
+    wakeup.notify_all();
+  }
+  
+  for(auto& worker : workers)
+    worker.join();
+  return writer.Close();
+}
+
+// Split
+
+static uint16_t VlanId(const BRAWcapFilePacket& packet)
+{
+  const uint8_t* pFrame = reinterpret_cast<const uint8_t*>(packet.Payload());
+  if(packet.PayloadLength() < 16)
+    return 0;
+  const uint16_t etherType = static_cast<uint16_t>(pFrame[12] << 8 | pFrame[13]);
+  if(etherType != 0x8100 && etherType != 0x88A8 && etherType != 0x9100)
+    return 0;
+  return static_cast<uint16_t>((pFrame[14] << 8 | pFrame[15]) & 0x0FFF);
+}
+
+static std::string SplitFileName(const Options& options, const uint64_t key)
+{
+  char suffix[32] = { '\0' };
+  if(options.splitMode == SplitMode::VLAN)
+    snprintf(suffix, sizeof(suffix), "_vlan%04u.pcap", static_cast<uint32_t>(key));
+  else
+    snprintf(suffix, sizeof(suffix), "_%05u.pcap", static_cast<uint32_t>(key));
+  return options.output + suffix;
+}
+
+// The input is processed in rounds of chunks: all threads classify one chunk each, then every thread writes the
+// outputs assigned to it, walking the chunks in order. Time windows older than the current round are closed, late
+// packets for a closed window go to the oldest open one.
+static bool Split(const Options& options, Totals& totals)
+{
+  std::vector<std::unique_ptr<BRAWcapFileReader>> readers;
+  if(!InputsOpen(options.inputs, readers))
+    return false;
+  BRAWcapFileReader& reader = *readers[0];
+  
+  const size_t chunkCount = static_cast<size_t>(std::max<uint64_t>(options.threads,
+    reader.Size() / (SLICE_BYTES / 4)));
+  const std::vector<uint64_t> points = reader.ResyncPoints(chunkCount);
+  
+  uint64_t firstNs = 0;
+  reader.ForEach([&firstNs](const BRAWcapFilePacket& packet)
+  {
+    firstNs = packet.TimestampTotalNs();
+    return false;
+  });
+  
+  std::map<uint64_t, std::unique_ptr<BRAWcapPcapWriter>> writers;
+  bool ok = true;
+  for(size_t round = 0; round < chunkCount && ok; round += options.threads)
+  {
+    const size_t chunks = std::min(options.threads, chunkCount - round);
+    std::vector<std::map<uint64_t, std::vector<BRAWcapFilePacket>>> classified(chunks);
+    
+    std::vector<std::thread> threads;
+    for(size_t chunk = 0; chunk < chunks; ++chunk)
+    {
+      threads.emplace_back([&, chunk]()
+      {
+        std::map<uint64_t, std::vector<BRAWcapFilePacket>>& outputs = classified[chunk];
+        reader.ForEachRange([&](const BRAWcapFilePacket& packet)
+        {
+          uint64_t key = 0;
+          if(options.splitMode == SplitMode::FLOW)
+            key = BRAWcapFlow::Bucket(BRAWcapFlow::Hash(packet.Payload(), packet.PayloadLength()),
+              static_cast<size_t>(options.splitValue));
+          else if(options.splitMode == SplitMode::VLAN)
+            key = VlanId(packet);
+          else
+            key = packet.TimestampTotalNs() > firstNs ? (packet.TimestampTotalNs() - firstNs) / options.splitValue : 0;
+          outputs[key].push_back(packet);
+        }, points[round + chunk], points[round + chunk + 1]);
+      });
+    }
+    for(auto& thread : threads)
+      thread.join();
+    
+    // Open the writers of this round on the main thread, the map is only read while writing.
+    uint64_t keyMin = UINT64_MAX;
+    for(const auto& outputs : classified)
+    {
+      for(const auto& output : outputs)
+      {
+        keyMin = std::min(keyMin, output.first);
+        if(writers.count(output.first))
+          continue;
+        if(options.splitMode == SplitMode::TIME && !writers.empty() && output.first < writers.begin()->first)
+          continue;
+        writers[output.first] = std::make_unique<BRAWcapPcapWriter>(SPLIT_STAGING_SIZE);
+        if(!writers[output.first]->Open(SplitFileName(options, output.first), SNAP_LENGTH, reader.LinkType()))
+        {
+          printf("[ERROR] Could not create %s.\n", SplitFileName(options, output.first).c_str());
+          return false;
+        }
+      }
+    }
+    
+    std::vector<std::pair<uint64_t, BRAWcapPcapWriter*>> assigned;
+    for(const auto& writer : writers)
+      assigned.emplace_back(writer.first, writer.second.get());
+    threads.clear();
+    for(size_t thread = 0; thread < options.threads; ++thread)
+    {
+      threads.emplace_back([&, thread]()
+      {
+        for(size_t index = thread; index < assigned.size(); index += options.threads)
+        {
+          for(size_t chunk = 0; chunk < chunks; ++chunk)
+          {
+            // Late time window packets are written by the thread owning the oldest open window.
+            for(const auto& output : classified[chunk])
+            {
+              const bool own = output.first == assigned[index].first;
+              const bool late = index == 0 && output.first < assigned[0].first;
+              if(!own && !late)
+                continue;
+              if(late)
+                totals.late += output.second.size();
+              for(const BRAWcapFilePacket& packet : output.second)
+              {
+                if(assigned[index].second->Write(packet))
+                {
+                  ++totals.packets;
+                  totals.bytes += packet.PayloadLength();
+                }
+                else
+                  ++totals.failed;
+              }
+            }
+          }
+        }
+      });
+    }
+    for(auto& thread : threads)
+      thread.join();
+    
+    // With time ordered input no packet of this round belongs before keyMin anymore.
+    if(options.splitMode == SplitMode::TIME)
+    {
+      while(writers.size() > 1 && writers.begin()->first < keyMin)
+      {
+        ok = writers.begin()->second->Close() && ok;
+        writers.erase(writers.begin());
+      }
+    }
+  }
+  
+  for(auto& writer : writers)
+    ok = writer.second->Close() && ok;
+  return ok;
+}
+
+int main(int argc, char** argv)
+{
+  Options options;
+  if(!ParseArgs(argc, argv, options))
+  {
+    Usage();
+    return EXIT_FAILURE;
+  }
+  
+  Totals totals;
+  const auto start = std::chrono::steady_clock::now();
+  const bool ok = options.command == "merge" ? Merge(options, totals) : Split(options, totals);
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  
+  printf("%s: %llu packets, %llu bytes in %.2f s (%.1f MB/s)\n", options.command.c_str(),
+    static_cast<unsigned long long>(totals.packets.load()), static_cast<unsigned long long>(totals.bytes.load()),
+    seconds, seconds > 0 ? totals.bytes.load() / seconds / 1e6 : 0.0);
+  if(totals.failed)
+    printf("[WARNING] %llu packets could not be written.\n", static_cast<unsigned long long>(totals.failed.load()));
+  if(totals.late)
+    printf("[WARNING] %llu packets were behind their closed time window and went to the oldest open one.\n",
+      static_cast<unsigned long long>(totals.late.load()));
+  return ok && !totals.failed ? EXIT_SUCCESS : EXIT_FAILURE;
+}